@@ -1,35 +1,750 @@
 #include "apu.h"
+#include "bus.h"
+#include "state.h"
+
+#include <algorithm>
 
 namespace cnes {
 
+  namespace {
+
+    // 长度计数器装载值
+    constexpr uint8_t LENGTH_TABLE[32] = {
+      10, 254, 20,  2, 40,  4, 80,  6, 160,  8, 60, 10, 14, 12, 26, 14,
+      12,  16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30,
+    };
+
+    // 方波占空比序列
+    constexpr uint8_t DUTY_TABLE[4][8] = {
+      {0, 1, 0, 0, 0, 0, 0, 0},
+      {0, 1, 1, 0, 0, 0, 0, 0},
+      {0, 1, 1, 1, 1, 0, 0, 0},
+      {1, 0, 0, 1, 1, 1, 1, 1},
+    };
+
+    // 三角波序列
+    constexpr uint8_t TRIANGLE_SEQUENCE[32] = {
+      15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1,  0,
+       0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+    };
+
+    // 噪声周期和DMC速率（CPU周期）
+    constexpr uint16_t NOISE_PERIODS_NTSC[16] = {
+      4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068,
+    };
+    constexpr uint16_t NOISE_PERIODS_PAL[16] = {
+      4, 8, 14, 30, 60, 88, 118, 148, 188, 236, 354, 472, 708, 944, 1890, 3778,
+    };
+    constexpr uint16_t DMC_RATES_NTSC[16] = {
+      428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54,
+    };
+    constexpr uint16_t DMC_RATES_PAL[16] = {
+      398, 354, 316, 298, 276, 236, 210, 198, 176, 148, 132, 118, 98, 78, 66, 50,
+    };
+
+    // 帧计数器各步的CPU周期：[制式][模式]，最后一项为序列长度
+    // 4步模式：1/4、1/2+1/4、1/4、1/2+1/4+IRQ；5步模式第4步不动作，第5步1/2+1/4
+    constexpr uint32_t FRAME_STEPS[2][2][6] = {
+      {{7457, 14913, 22371, 29829, 29830, 29830}, {7457, 14913, 22371, 29829, 37281, 37282}},
+      {{8313, 16627, 24939, 33253, 33254, 33254}, {8313, 16627, 24939, 33253, 41565, 41566}},
+    };
+
+    // CPU主频（Hz）
+    constexpr double CPU_RATE_NTSC = 1789773.0;
+    constexpr double CPU_RATE_PAL = 1662607.0;
+    constexpr double CPU_RATE_DENDY = 1773448.0;
+
+    // 线性混音系数（对非线性混音公式在常用范围内的近似），各声道可以独立登记幅度差
+    constexpr float CHANNEL_WEIGHTS[5] = {0.00752f, 0.00752f, 0.00851f, 0.00494f, 0.00335f};
+
+    // 噪声移位寄存器一步的反馈抽头位置（长/短周期模式）
+    constexpr int NOISE_TAPS[2] = {1, 6};
+
+    uint16_t noise_step(uint16_t shift, int tap)
+    {
+      uint16_t feedback = (shift ^ (shift >> tap)) & 0x01;
+      return (shift >> 1) | (feedback << 14);
+    }
+
+    // 移位寄存器是GF(2)上的线性变换，预先算出前进2^i步的矩阵（按列存放），
+    // 静音时可以一次跳过任意步数
+    struct NoiseJump {
+      uint16_t columns[2][32][15];
+
+      NoiseJump()
+      {
+        for (int mode = 0; mode < 2; mode++) {
+          for (int bit = 0; bit < 15; bit++) {
+            columns[mode][0][bit] = noise_step(1 << bit, NOISE_TAPS[mode]);
+          }
+          for (int power = 1; power < 32; power++) {
+            for (int bit = 0; bit < 15; bit++) {
+              columns[mode][power][bit] = apply(columns[mode][power - 1], columns[mode][power - 1][bit]);
+            }
+          }
+        }
+      }
+
+      static uint16_t apply(const uint16_t* matrix, uint16_t shift)
+      {
+        uint16_t result = 0;
+        for (int bit = 0; bit < 15; bit++) {
+          if (shift & (1 << bit)) {
+            result ^= matrix[bit];
+          }
+        }
+        return result;
+      }
+
+      uint16_t advance(uint16_t shift, bool mode, uint32_t steps) const
+      {
+        for (int power = 0; steps; power++, steps >>= 1) {
+          if (steps & 1) {
+            shift = apply(columns[mode][power], shift);
+          }
+        }
+        return shift;
+      }
+    };
+
+    // 合成缓冲每隔这么多CPU周期结束一帧，帧计数器两步之间不超过9000周期
+    constexpr uint32_t BLIP_FRAME = 8192;
+    constexpr uint32_t BLIP_MAX_FRAME = BLIP_FRAME + 9000;
+
+  } // namespace
+
   APU::APU()
   {
-
+    set_region(Region::NTSC);
+    reset();
   }
 
   void APU::clock()
   {
+    run(1);
+  }
+
+  void APU::run(uint32_t cycles)
+  {
+    while (cycles > 0) {
+      // 推进到下一个帧计数器步或本次结束，各声道在一段内按公式跳到下一次电平变化
+      uint32_t step = std::min(cycles, frame_steps()[frame_step_] - frame_cycle_);
+      uint32_t end = time_ + step;
+      run_channels(end);
+      if (output_enabled_) {
+        time_ = end;
+      }
+      frame_cycle_ += step;
+      cycles -= step;
+
+      if (frame_cycle_ == frame_steps()[frame_step_]) {
+        frame_tick();
+      }
+      if (time_ >= BLIP_FRAME) {
+        end_frame();
+      }
+    }
+  }
+
+  int32_t APU::cycles_until_irq() const
+  {
+    int32_t cycles = -1;
 
+    // 4步模式第4步置帧IRQ（已置位时保持到读取$4015）
+    if (!(frame_counter_ & 0xC0) && !frame_interrupt_) {
+      const uint32_t* steps = frame_steps();
+      cycles = frame_step_ <= 3 ? steps[3] - frame_cycle_ : steps[5] - frame_cycle_ + steps[3];
+    }
+
+    // DMC读完最后一个字节时置IRQ：缓冲中的字节在当前字节移完时被取走并读入下一个，之后每8位读一个
+    if (dmc_.irq_enabled && !dmc_.loop && !dmc_.interrupt && dmc_.remaining > 0 && dmc_.buffer_full) {
+      uint32_t period = dmc_rates_[dmc_.rate];
+      int32_t dmc = static_cast<int32_t>(dmc_.counter + (dmc_.bits - 1) * period + (dmc_.remaining - 1) * 8 * period);
+      cycles = cycles < 0 ? dmc : std::min(cycles, dmc);
+    }
+    return cycles;
   }
 
   void APU::reset()
   {
+    pulse1_ = Pulse{};
+    pulse2_ = Pulse{};
+    triangle_ = Triangle{};
+    noise_ = Noise{};
+    dmc_ = Dmc{};
+    pulse1_.counter = 2;
+    pulse2_.counter = 2;
+    triangle_.counter = 1;
+    noise_.shift = 1;
+    noise_.counter = noise_periods_[0];
+    dmc_.bits = 8;
+    dmc_.silence = true;
+    dmc_.counter = dmc_rates_[0];
+
+    enabled_ = 0;
+    frame_counter_ = 0;
+    frame_cycle_ = 0;
+    frame_step_ = 0;
+    frame_interrupt_ = false;
+    update_levels();
+  }
+
+  void APU::set_region(Region region)
+  {
+    region_ = region;
+    bool pal = region != Region::NTSC;
+    noise_periods_ = pal ? NOISE_PERIODS_PAL : NOISE_PERIODS_NTSC;
+    dmc_rates_ = pal ? DMC_RATES_PAL : DMC_RATES_NTSC;
+    set_sample_rate(sample_rate_);
+  }
 
+  const uint32_t* APU::frame_steps() const
+  {
+    return FRAME_STEPS[region_ != Region::NTSC][(frame_counter_ & 0x80) ? 1 : 0];
   }
 
   uint8_t APU::read_register(uint16_t addr)
   {
+    if (addr != 0x4015) {
+      return 0x00;
+    }
 
+    // 状态：各声道长度计数器非0、DMC剩余字节、帧IRQ、DMC IRQ；读取清除帧IRQ
+    uint8_t data = (pulse1_.length > 0 ? 0x01 : 0)
+                 | (pulse2_.length > 0 ? 0x02 : 0)
+                 | (triangle_.length > 0 ? 0x04 : 0)
+                 | (noise_.length > 0 ? 0x08 : 0)
+                 | (dmc_.remaining > 0 ? 0x10 : 0)
+                 | (frame_interrupt_ ? 0x40 : 0)
+                 | (dmc_.interrupt ? 0x80 : 0);
+    frame_interrupt_ = false;
+    return data;
   }
 
   void APU::write_register(uint16_t addr, uint8_t data)
   {
+    switch (addr) {
+      case 0x4000: case 0x4001: case 0x4002: case 0x4003:
+        write_pulse(pulse1_, addr & 0x03, data);
+        break;
+      case 0x4004: case 0x4005: case 0x4006: case 0x4007:
+        write_pulse(pulse2_, addr & 0x03, data);
+        break;
+
+      case 0x4008:
+        triangle_.control = data & 0x80;
+        triangle_.linear_load = data & 0x7F;
+        break;
+      case 0x400A:
+        triangle_.period = (triangle_.period & 0x0700) | data;
+        break;
+      case 0x400B:
+        triangle_.period = (triangle_.period & 0x00FF) | ((data & 0x07) << 8);
+        if (enabled_ & 0x04) {
+          triangle_.length = LENGTH_TABLE[data >> 3];
+        }
+        triangle_.linear_reload = true;
+        break;
+
+      case 0x400C:
+        noise_.envelope.loop = data & 0x20;
+        noise_.envelope.constant = data & 0x10;
+        noise_.envelope.volume = data & 0x0F;
+        break;
+      case 0x400E:
+        noise_.mode = data & 0x80;
+        noise_.rate = data & 0x0F;
+        break;
+      case 0x400F:
+        if (enabled_ & 0x08) {
+          noise_.length = LENGTH_TABLE[data >> 3];
+        }
+        noise_.envelope.start = true;
+        break;
+
+      case 0x4010:
+        dmc_.irq_enabled = data & 0x80;
+        dmc_.loop = data & 0x40;
+        dmc_.rate = data & 0x0F;
+        if (!dmc_.irq_enabled) {
+          dmc_.interrupt = false;
+        }
+        break;
+      case 0x4011:
+        dmc_.level = data & 0x7F;
+        break;
+      case 0x4012:
+        dmc_.sample_address = 0xC000 + data * 64;
+        break;
+      case 0x4013:
+        dmc_.sample_length = data * 16 + 1;
+        break;
+
+      case 0x4015:
+        enabled_ = data & 0x1F;
+        if (!(data & 0x01)) pulse1_.length = 0;
+        if (!(data & 0x02)) pulse2_.length = 0;
+        if (!(data & 0x04)) triangle_.length = 0;
+        if (!(data & 0x08)) noise_.length = 0;
+        if (!(data & 0x10)) {
+          dmc_.remaining = 0;
+        }
+        else if (dmc_.remaining == 0) {
+          dmc_restart();
+          dmc_fetch();
+        }
+        dmc_.interrupt = false;
+        break;
+
+      case 0x4017:
+        // 重新开始序列（忽略写入后3-4个周期的延迟），5步模式立即产生一次1/2和1/4帧时钟
+        frame_counter_ = data;
+        if (data & 0x40) {
+          frame_interrupt_ = false;
+        }
+        frame_cycle_ = 0;
+        frame_step_ = 0;
+        if (data & 0x80) {
+          quarter_frame();
+          half_frame();
+        }
+        break;
+
+      default:
+        break;
+    }
+
+    update_levels();
+  }
+
+  void APU::write_pulse(Pulse& pulse, uint16_t reg, uint8_t data)
+  {
+    switch (reg) {
+      case 0:
+        pulse.duty = data >> 6;
+        pulse.envelope.loop = data & 0x20;
+        pulse.envelope.constant = data & 0x10;
+        pulse.envelope.volume = data & 0x0F;
+        break;
+      case 1:
+        pulse.sweep_enabled = data & 0x80;
+        pulse.sweep_period = (data >> 4) & 0x07;
+        pulse.sweep_negate = data & 0x08;
+        pulse.sweep_shift = data & 0x07;
+        pulse.sweep_reload = true;
+        break;
+      case 2:
+        pulse.period = (pulse.period & 0x0700) | data;
+        break;
+      case 3:
+        pulse.period = (pulse.period & 0x00FF) | ((data & 0x07) << 8);
+        if (enabled_ & (&pulse == &pulse1_ ? 0x01 : 0x02)) {
+          pulse.length = LENGTH_TABLE[data >> 3];
+        }
+        pulse.step = 0;
+        pulse.envelope.start = true;
+        break;
+    }
+  }
+
+  void APU::set_sample_rate(uint32_t rate)
+  {
+    sample_rate_ = rate;
+    time_ = 0;
+    if (rate == 0) {
+      blip_ = BlipBuffer();
+      return;
+    }
+    double clock_rate = region_ == Region::NTSC ? CPU_RATE_NTSC
+                      : region_ == Region::PAL ? CPU_RATE_PAL : CPU_RATE_DENDY;
+    blip_.set_rates(clock_rate, rate, BLIP_MAX_FRAME);
+
+    // 合成缓冲从0开始积分，按当前电平重新登记
+    levels_.fill(0);
+    update_levels();
+  }
 
+  size_t APU::read_samples(int16_t* out, size_t count)
+  {
+    end_frame();
+    return blip_.read_samples(out, count);
+  }
+
+  void APU::set_output(bool enabled)
+  {
+    output_enabled_ = enabled;
+    if (enabled) {
+      update_levels();
+    }
   }
 
   float APU::get_audio_sample()
   {
+    float sample = 0.0f;
+    for (int channel = 0; channel < CHANNEL_COUNT; channel++) {
+      sample += levels_[channel] * CHANNEL_WEIGHTS[channel];
+    }
+    return sample;
+  }
+
+  void APU::end_frame()
+  {
+    blip_.end_frame(time_);
+    time_ = 0;
+  }
+
+  void APU::set_level(CHANNEL channel, uint8_t level, uint32_t time)
+  {
+    if (level == levels_[channel] || !output_enabled_) {
+      return;
+    }
+    if (blip_.enabled()) {
+      blip_.add_delta(time, (static_cast<int>(level) - levels_[channel]) * CHANNEL_WEIGHTS[channel]);
+    }
+    levels_[channel] = level;
+  }
+
+  void APU::update_levels()
+  {
+    // 寄存器写入、帧计数器或读档改变了音量/静音状态，从当前时刻起生效
+    set_level(PULSE1, pulse_output(pulse1_, false), time_);
+    set_level(PULSE2, pulse_output(pulse2_, true), time_);
+    set_level(TRIANGLE, triangle_output(), time_);
+    set_level(NOISE, noise_output(), time_);
+    set_level(DMC, dmc_.level, time_);
+  }
+
+  void APU::run_channels(uint32_t end)
+  {
+    run_pulse(pulse1_, PULSE1, end);
+    run_pulse(pulse2_, PULSE2, end);
+    run_triangle(end);
+    run_noise(end);
+    run_dmc(end);
+  }
+
+  void APU::run_pulse(Pulse& pulse, CHANNEL channel, uint32_t end)
+  {
+    uint32_t span = end - time_;
+    if (pulse.counter > span) {
+      pulse.counter -= span;
+      return;
+    }
+
+    uint32_t period = (pulse.period + 1) * 2;
+    uint32_t time = time_ + pulse.counter;
+    uint8_t volume = envelope_volume(pulse.envelope);
+
+    if (!synthesizing() || !pulse_audible(pulse, channel == PULSE2)) {
+      // 不发声时只需推进序列位置
+      uint32_t steps = (end - time) / period + 1;
+      pulse.step = (pulse.step + steps) & 0x07;
+      time += steps * period;
+    }
+    else {
+      while (time <= end) {
+        pulse.step = (pulse.step + 1) & 0x07;
+        set_level(channel, DUTY_TABLE[pulse.duty][pulse.step] ? volume : 0, time);
+        time += period;
+      }
+    }
+    pulse.counter = time - end;
+  }
+
+  void APU::run_triangle(uint32_t end)
+  {
+    uint32_t span = end - time_;
+    if (triangle_.counter > span) {
+      triangle_.counter -= span;
+      return;
+    }
+
+    uint32_t period = triangle_.period + 1;
+    uint32_t time = time_ + triangle_.counter;
+    uint32_t steps = (end - time) / period + 1;
+
+    // 长度或线性计数器为0时序列停住；周期过短的超声频率也停住，避免混叠出杂音
+    if (triangle_.length > 0 && triangle_.linear > 0 && triangle_.period >= 2) {
+      if (!synthesizing()) {
+        triangle_.step = (triangle_.step + steps) & 0x1F;
+      }
+      else {
+        for (uint32_t i = 0; i < steps; i++) {
+          triangle_.step = (triangle_.step + 1) & 0x1F;
+          set_level(TRIANGLE, TRIANGLE_SEQUENCE[triangle_.step], time + i * period);
+        }
+      }
+    }
+    triangle_.counter = time + steps * period - end;
+  }
+
+  void APU::run_noise(uint32_t end)
+  {
+    uint32_t span = end - time_;
+    if (noise_.counter > span) {
+      noise_.counter -= span;
+      return;
+    }
+
+    uint32_t period = noise_periods_[noise_.rate];
+    uint32_t time = time_ + noise_.counter;
+    uint8_t volume = noise_.length > 0 && synthesizing() ? envelope_volume(noise_.envelope) : 0;
+
+    if (volume == 0) {
+      // 静音时移位寄存器仍要推进（之后的输出取决于它），按步数直接跳过去
+      static const NoiseJump jump;
+      uint32_t steps = (end - time) / period + 1;
+      noise_.shift = jump.advance(noise_.shift, noise_.mode, steps);
+      noise_.counter = time + steps * period - end;
+      return;
+    }
+
+    int tap = NOISE_TAPS[noise_.mode];
+    while (time <= end) {
+      noise_.shift = noise_step(noise_.shift, tap);
+      set_level(NOISE, (noise_.shift & 0x01) ? 0 : volume, time);
+      time += period;
+    }
+    noise_.counter = time - end;
+  }
+
+  void APU::run_dmc(uint32_t end)
+  {
+    uint32_t span = end - time_;
+    if (dmc_.counter > span) {
+      dmc_.counter -= span;
+      return;
+    }
+
+    uint32_t period = dmc_rates_[dmc_.rate];
+    uint32_t time = time_ + dmc_.counter;
+
+    if (dmc_.silence && !dmc_.buffer_full && dmc_.remaining == 0) {
+      // 没有样本可播放时只有移位计数在循环
+      uint32_t steps = (end - time) / period + 1;
+      dmc_.bits = static_cast<uint8_t>((dmc_.bits + 8 - steps % 8) % 8);
+      if (dmc_.bits == 0) {
+        dmc_.bits = 8;
+      }
+      dmc_.counter = time + steps * period - end;
+      return;
+    }
+
+    while (time <= end) {
+      if (!dmc_.silence) {
+        if (dmc_.shift & 0x01) {
+          if (dmc_.level <= 125) {
+            dmc_.level += 2;
+          }
+        }
+        else if (dmc_.level >= 2) {
+          dmc_.level -= 2;
+        }
+        set_level(DMC, dmc_.level, time);
+      }
+      dmc_.shift >>= 1;
+
+      if (--dmc_.bits == 0) {
+        dmc_.bits = 8;
+        dmc_.silence = !dmc_.buffer_full;
+        if (dmc_.buffer_full) {
+          dmc_.shift = dmc_.buffer;
+          dmc_.buffer_full = false;
+          dmc_fetch();
+        }
+      }
+      time += period;
+    }
+    dmc_.counter = time - end;
+  }
+
+  void APU::dmc_restart()
+  {
+    dmc_.address = dmc_.sample_address;
+    dmc_.remaining = dmc_.sample_length;
+  }
+
+  void APU::dmc_fetch()
+  {
+    // 样本读取不计CPU暂停的周期
+    if (dmc_.buffer_full || dmc_.remaining == 0 || !bus_) {
+      return;
+    }
+    dmc_.buffer = bus_->read(dmc_.address);
+    dmc_.buffer_full = true;
+    dmc_.address = dmc_.address == 0xFFFF ? 0x8000 : dmc_.address + 1;
+    if (--dmc_.remaining == 0) {
+      if (dmc_.loop) {
+        dmc_restart();
+      }
+      else if (dmc_.irq_enabled) {
+        dmc_.interrupt = true;
+      }
+    }
+  }
+
+  bool APU::pulse_audible(const Pulse& pulse, bool second)
+  {
+    // 长度计数器为0、周期过短或扫频目标溢出时静音
+    return pulse.length > 0 && pulse.period >= 8 && sweep_target(pulse, second) <= 0x7FF &&
+           envelope_volume(pulse.envelope) > 0;
+  }
+
+  uint8_t APU::pulse_output(const Pulse& pulse, bool second)
+  {
+    if (!pulse_audible(pulse, second)) {
+      return 0;
+    }
+    return DUTY_TABLE[pulse.duty][pulse.step] ? envelope_volume(pulse.envelope) : 0;
+  }
+
+  uint8_t APU::triangle_output() const
+  {
+    return TRIANGLE_SEQUENCE[triangle_.step];
+  }
+
+  uint8_t APU::noise_output() const
+  {
+    return noise_.length > 0 && !(noise_.shift & 0x01) ? envelope_volume(noise_.envelope) : 0;
+  }
+
+  void APU::frame_tick()
+  {
+    bool five_step = frame_counter_ & 0x80;
+    switch (frame_step_) {
+      case 0:
+      case 2:
+        quarter_frame();
+        break;
+      case 1:
+        quarter_frame();
+        half_frame();
+        break;
+      case 3:
+        if (!five_step) {
+          quarter_frame();
+          half_frame();
+          if (!(frame_counter_ & 0x40)) {
+            frame_interrupt_ = true;
+          }
+        }
+        break;
+      case 4:
+        if (five_step) {
+          quarter_frame();
+          half_frame();
+        }
+        break;
+      default:
+        break;
+    }
+
+    // 4步模式第5项与序列长度相同，下一项就是序列结束
+    frame_step_++;
+    if (frame_cycle_ >= frame_steps()[5]) {
+      frame_cycle_ = 0;
+      frame_step_ = 0;
+    }
+    update_levels();
+  }
+
+  void APU::quarter_frame()
+  {
+    clock_envelope(pulse1_.envelope);
+    clock_envelope(pulse2_.envelope);
+    clock_envelope(noise_.envelope);
+
+    if (triangle_.linear_reload) {
+      triangle_.linear = triangle_.linear_load;
+    }
+    else if (triangle_.linear > 0) {
+      triangle_.linear--;
+    }
+    if (!triangle_.control) {
+      triangle_.linear_reload = false;
+    }
+  }
+
+  void APU::half_frame()
+  {
+    if (pulse1_.length > 0 && !pulse1_.envelope.loop) pulse1_.length--;
+    if (pulse2_.length > 0 && !pulse2_.envelope.loop) pulse2_.length--;
+    if (triangle_.length > 0 && !triangle_.control) triangle_.length--;
+    if (noise_.length > 0 && !noise_.envelope.loop) noise_.length--;
+
+    clock_sweep(pulse1_, false);
+    clock_sweep(pulse2_, true);
+  }
+
+  void APU::clock_envelope(Envelope& envelope)
+  {
+    if (envelope.start) {
+      envelope.start = false;
+      envelope.decay = 15;
+      envelope.divider = envelope.volume;
+    }
+    else if (envelope.divider == 0) {
+      envelope.divider = envelope.volume;
+      if (envelope.decay > 0) {
+        envelope.decay--;
+      }
+      else if (envelope.loop) {
+        envelope.decay = 15;
+      }
+    }
+    else {
+      envelope.divider--;
+    }
+  }
+
+  void APU::clock_sweep(Pulse& pulse, bool second)
+  {
+    uint16_t target = sweep_target(pulse, second);
+    if (pulse.sweep_divider == 0 && pulse.sweep_enabled && pulse.sweep_shift > 0 &&
+        pulse.period >= 8 && target <= 0x7FF) {
+      pulse.period = target;
+    }
+    if (pulse.sweep_divider == 0 || pulse.sweep_reload) {
+      pulse.sweep_divider = pulse.sweep_period;
+      pulse.sweep_reload = false;
+    }
+    else {
+      pulse.sweep_divider--;
+    }
+  }
+
+  uint16_t APU::sweep_target(const Pulse& pulse, bool second)
+  {
+    // 方波1取反时多减1（反码），方波2为补码
+    int change = pulse.period >> pulse.sweep_shift;
+    if (pulse.sweep_negate) {
+      return static_cast<uint16_t>(std::max(0, pulse.period - change - (second ? 0 : 1)));
+    }
+    return static_cast<uint16_t>(pulse.period + change);
+  }
+
+  uint8_t APU::envelope_volume(const Envelope& envelope)
+  {
+    return envelope.constant ? envelope.volume : envelope.decay;
+  }
+
+  void APU::serialize(StateStream& state)
+  {
+    state(pulse1_);
+    state(pulse2_);
+    state(triangle_);
+    state(noise_);
+    state(dmc_);
+    state(enabled_);
+    state(frame_counter_);
+    state(frame_cycle_);
+    state(frame_step_);
+    state(frame_interrupt_);
 
+    if (state.loading()) {
+      // 合成缓冲不在存档中，从当前时刻接到读取的电平
+      update_levels();
+    }
   }
 
 
@@ -1,14 +1,21 @@
 #ifndef CNES_APU_H
 #define CNES_APU_H
 
+#include <cstddef>
 #include <cstdint>
 #include <array>
+#include "blip_buffer.h"
+#include "scheduler.h"
 
 namespace cnes {
 
 class Bus;
+class StateStream;
 
-// Audio Processing Unit
+// Audio Processing Unit (2A03)
+// 平时不运行，由总线在访问寄存器、IRQ到期或取采样时一次推进到当前时间。
+// 各声道的定时器以倒计数保存，不输出声音时整段按公式跳过，
+// 输出声音时电平只在变化时向带限合成缓冲登记一次幅度差
 class APU {
 public:
     APU();
@@ -18,70 +25,176 @@ public:
     void connect_bus(Bus* bus) { bus_ = bus; }
 
     // APU操作
-    void clock();    // 时钟周期
-    void reset();    // 重置APU
+    void clock();                // 时钟周期（一个CPU周期）
+    void run(uint32_t cycles);   // 批量推进若干个CPU周期
+    void reset();                // 重置APU
+
+    void set_region(Region region);
 
     // APU寄存器接口（CPU访问）
     uint8_t read_register(uint16_t addr);
     void write_register(uint16_t addr, uint8_t data);
 
-    // 获取音频样本
+    // 帧计数器或DMC的IRQ
+    bool irq() const { return frame_interrupt_ || dmc_.interrupt; }
+
+    // 距离下一次置IRQ还有多少个CPU周期，不会产生时返回-1
+    int32_t cycles_until_irq() const;
+
+    // 设置输出采样率后开始合成，0表示不输出声音（声道照常运行）
+    void set_sample_rate(uint32_t rate);
+
+    // 读出已合成的16位单声道采样，返回实际个数
+    size_t read_samples(int16_t* out, size_t count);
+
+    // 关闭后不登记幅度差（预先运行的中间帧用），重新打开时从当前电平接上
+    void set_output(bool enabled);
+
+    // 获取当前混合输出（-1..1附近，未滤波）
     float get_audio_sample();
 
+    // 存档（不含合成缓冲）
+    void serialize(StateStream& state);
+
 private:
-    // 方波通道1
-    struct {
-        uint8_t duty = 0;           // 占空比
-        uint8_t volume = 0;          // 音量
-        uint16_t frequency = 0;      // 频率
-        bool length_enabled = false;  // 长度计数器启用
-        uint8_t length_counter = 0;  // 长度计数器
-    } pulse1_{};
-
-    // 方波通道2
-    struct {
-        uint8_t duty = 0;
-        uint8_t volume = 0;
-        uint16_t frequency = 0;
-        bool length_enabled = false;
-        uint8_t length_counter = 0;
-    } pulse2_{};
+    // 包络
+    struct Envelope {
+        bool start;
+        bool loop;            // 同时是长度计数器暂停位
+        bool constant;
+        uint8_t volume;       // 常量音量/包络周期
+        uint8_t divider;
+        uint8_t decay;
+    };
+
+    // 方波通道
+    struct Pulse {
+        Envelope envelope;
+        uint8_t duty;
+        uint8_t step;         // 序列位置0-7
+        uint16_t period;      // 11位定时器周期
+        uint32_t counter;     // 距下一步的CPU周期
+        uint8_t length;
+        bool sweep_enabled;
+        bool sweep_negate;
+        bool sweep_reload;
+        uint8_t sweep_period;
+        uint8_t sweep_shift;
+        uint8_t sweep_divider;
+    };
 
     // 三角波通道
-    struct {
-        uint16_t frequency = 0;
-        bool length_enabled = false;
-        uint8_t length_counter = 0;
-    } triangle_{};
+    struct Triangle {
+        bool control;         // 线性计数器控制/长度计数器暂停
+        uint8_t linear_load;
+        uint8_t linear;
+        bool linear_reload;
+        uint8_t step;         // 序列位置0-31
+        uint16_t period;
+        uint32_t counter;
+        uint8_t length;
+    };
 
     // 噪声通道
-    struct {
-        uint8_t volume = 0;
-        uint16_t frequency = 0;
-        bool length_enabled = false;
-        uint8_t length_counter = 0;
-    } noise_{};
+    struct Noise {
+        Envelope envelope;
+        bool mode;            // 短周期模式
+        uint8_t rate;         // 周期表索引
+        uint16_t shift;       // 15位线性反馈移位寄存器
+        uint32_t counter;
+        uint8_t length;
+    };
 
     // DMC通道
-    struct {
-        uint16_t frequency = 0;
-        uint16_t sample_address = 0;
-        uint16_t sample_length = 0;
-        bool loop = false;
-    } dmc_{};
+    struct Dmc {
+        bool irq_enabled;
+        bool loop;
+        bool interrupt;
+        uint8_t rate;
+        uint8_t level;        // 7位输出电平
+        uint16_t sample_address;
+        uint16_t sample_length;
+        uint16_t address;     // 下一个要读取的字节
+        uint16_t remaining;   // 还要读取的字节数
+        uint8_t buffer;
+        bool buffer_full;
+        uint8_t shift;
+        uint8_t bits;         // 移位寄存器剩余位数
+        bool silence;
+        uint32_t counter;
+    };
+
+    Pulse pulse1_{};
+    Pulse pulse2_{};
+    Triangle triangle_{};
+    Noise noise_{};
+    Dmc dmc_{};
+
+    uint8_t enabled_ = 0;             // $4015写入的声道开关
 
     // 帧计数器
-    uint8_t frame_counter_ = 0;
+    uint8_t frame_counter_ = 0;       // $4017写入值
+    uint32_t frame_cycle_ = 0;        // 当前序列中的CPU周期
+    uint8_t frame_step_ = 0;          // 下一个序列步
     bool frame_interrupt_ = false;
 
+    // 制式相关的时序表
+    Region region_ = Region::NTSC;
+    const uint16_t* noise_periods_ = nullptr;
+    const uint16_t* dmc_rates_ = nullptr;
+    const uint32_t* frame_steps() const;    // 当前模式各序列步的CPU周期
+
+    // 带限合成：time_为本帧内的CPU周期，levels_为各声道已登记的电平
+    enum CHANNEL {
+        PULSE1,
+        PULSE2,
+        TRIANGLE,
+        NOISE,
+        DMC,
+        CHANNEL_COUNT
+    };
+    BlipBuffer blip_;
+    uint32_t sample_rate_ = 0;
+    uint32_t time_ = 0;
+    bool output_enabled_ = true;
+    std::array<uint8_t, CHANNEL_COUNT> levels_{};
+
+    bool synthesizing() const { return output_enabled_ && blip_.enabled(); }
+
+    void set_level(CHANNEL channel, uint8_t level, uint32_t time);
+    void update_levels();
+    void end_frame();
+
+    // 各声道推进到本帧end时刻
+    void run_channels(uint32_t end);
+    void run_pulse(Pulse& pulse, CHANNEL channel, uint32_t end);
+    void run_triangle(uint32_t end);
+    void run_noise(uint32_t end);
+    void run_dmc(uint32_t end);
+
+    // 当前输出电平
+    static bool pulse_audible(const Pulse& pulse, bool second);
+    static uint8_t pulse_output(const Pulse& pulse, bool second);
+    uint8_t triangle_output() const;
+    uint8_t noise_output() const;
+
+    // 帧计数器驱动的单元
+    void frame_tick();
+    void quarter_frame();
+    void half_frame();
+    static void clock_envelope(Envelope& envelope);
+    static void clock_sweep(Pulse& pulse, bool second);
+    static uint16_t sweep_target(const Pulse& pulse, bool second);
+    static uint8_t envelope_volume(const Envelope& envelope);
+
+    void write_pulse(Pulse& pulse, uint16_t reg, uint8_t data);
+    void dmc_restart();
+    void dmc_fetch();
+
     // 总线指针
     Bus* bus_ = nullptr;
-
-    // 内存访问
-    uint8_t read(uint16_t addr);
-    void write(uint16_t addr, uint8_t data);
 };
 
 } // namespace cnes
 
-#endif // CNES_APU_H
\ No newline at end of file
+#endif // CNES_APU_H
@@ -0,0 +1,64 @@
+#include "audio.h"
+
+namespace cnes {
+
+namespace {
+
+// 环形缓冲约1/4秒，声卡每次取512个采样
+constexpr size_t RING_SAMPLES = 12288;
+constexpr Uint16 DEVICE_SAMPLES = 512;
+
+} // namespace
+
+Audio::Audio() : ring_(RING_SAMPLES) {
+}
+
+Audio::~Audio() {
+    cleanup();
+}
+
+bool Audio::init(int sample_rate) {
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        return false;
+    }
+
+    SDL_AudioSpec want{};
+    want.freq = sample_rate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = DEVICE_SAMPLES;
+    want.callback = &Audio::callback;
+    want.userdata = this;
+
+    SDL_AudioSpec have{};
+    device_ = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0);
+    if (device_ == 0) {
+        return false;
+    }
+    sample_rate_ = have.freq;
+    SDL_PauseAudioDevice(device_, 0);
+    return true;
+}
+
+void Audio::cleanup() {
+    if (device_) {
+        SDL_CloseAudioDevice(device_);
+        device_ = 0;
+    }
+}
+
+void Audio::callback(void* userdata, Uint8* stream, int length) {
+    Audio* audio = static_cast<Audio*>(userdata);
+    int16_t* out = reinterpret_cast<int16_t*>(stream);
+    size_t count = static_cast<size_t>(length) / sizeof(int16_t);
+
+    size_t got = audio->ring_.pop(out, count);
+    if (got > 0) {
+        audio->last_ = out[got - 1];
+    }
+    for (size_t i = got; i < count; i++) {
+        out[i] = audio->last_;
+    }
+}
+
+} // namespace cnes
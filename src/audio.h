@@ -0,0 +1,40 @@
+#ifndef CNES_AUDIO_H
+#define CNES_AUDIO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <SDL2/SDL.h>
+#include "ring_buffer.h"
+
+namespace cnes {
+
+// 声音输出
+// 模拟线程把合成好的采样写入无锁环形缓冲，SDL的音频回调从中取出；
+// 缓冲空时重复最后一个采样，满时丢弃新采样，双方都不加锁
+class Audio {
+public:
+    Audio();
+    ~Audio();
+
+    // 打开声卡（单声道16位），失败时返回false
+    bool init(int sample_rate);
+
+    int sample_rate() const { return sample_rate_; }
+
+    // 写入采样（模拟线程调用）
+    void push(const int16_t* samples, size_t count) { ring_.push(samples, count); }
+
+    void cleanup();
+
+private:
+    static void callback(void* userdata, Uint8* stream, int length);
+
+    SDL_AudioDeviceID device_ = 0;
+    int sample_rate_ = 0;
+    RingBuffer<int16_t> ring_;
+    int16_t last_ = 0;
+};
+
+} // namespace cnes
+
+#endif // CNES_AUDIO_H
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "machine.h"
+#include "movie.h"
+#include "input_script.h"
+#include "work_pool.h"
+
+using namespace cnes;
+
+namespace {
+
+// 一个批处理任务
+struct Job {
+    std::string rom;
+    std::string input;      // .cnm录像、输入脚本或"-"
+    uint32_t frames = 0;    // 0表示录像长度
+};
+
+struct JobResult {
+    const char* error = nullptr;
+    uint32_t frames = 0;
+    double seconds = 0.0;
+    uint64_t ram_hash = 0;
+    uint64_t frame_hash = 0;
+};
+
+// 任务文件：每行 "<rom> <录像|输入脚本|-> [帧数]"，'#' 开头为注释
+bool load_jobs(const char* path, std::vector<Job>& jobs) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        Job job;
+        std::string frames;
+        if (!(ss >> job.rom) || job.rom[0] == '#') {
+            continue;
+        }
+        if (!(ss >> job.input)) {
+            return false;
+        }
+        if (ss >> frames) {
+            job.frames = static_cast<uint32_t>(std::strtoul(frames.c_str(), nullptr, 10));
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+// 每个任务一台独立的机器，只共享只读的ROM映像
+void run_job(const Job& job, JobResult& result) {
+    std::shared_ptr<const RomImage> rom = RomImage::open(job.rom);
+    if (!rom) {
+        result.error = "cannot open ROM";
+        return;
+    }
+
+    Movie movie;
+    InputScript script;
+    bool use_movie = ends_with(job.input, ".cnm");
+    uint32_t frames = job.frames;
+    if (use_movie) {
+        Movie::LOAD_RESULT loaded = movie.load_for(job.input, *rom);
+        if (loaded != Movie::LOADED) {
+            result.error = loaded == Movie::ROM_MISMATCH ? "movie ROM mismatch" : "invalid movie";
+            return;
+        }
+        if (frames == 0) {
+            frames = movie.frame_count();
+        }
+    }
+    else if (job.input != "-" && !script.load(job.input)) {
+        result.error = "invalid input script";
+        return;
+    }
+
+    std::unique_ptr<Machine> machine = Machine::create(rom);
+    if (!machine) {
+        result.error = "ROM load fail";
+        return;
+    }
+
+    Bus& bus = machine->bus();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        if (use_movie) {
+            movie.apply(bus, frame);
+        }
+        else {
+            script.apply(bus, frame);
+        }
+        bus.run_frame();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.frames = frames;
+
+    uint8_t ram[0x0800];
+    for (uint16_t addr = 0; addr < sizeof(ram); addr++) {
+        ram[addr] = bus.peek(addr);
+    }
+    result.ram_hash = fnv1a64(ram, sizeof(ram));
+    result.frame_hash = fnv1a64(machine->screen(), 256 * 240);
+}
+
+} // namespace
+
+// 批量运行：任务分配到工作窃取线程池，全部完成后按任务顺序输出散列和耗时
+int main(int argc, char* argv[]) {
+    const char* jobs_path = nullptr;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            jobs_path = argv[i];
+        }
+    }
+    if (!jobs_path) {
+        std::fprintf(stderr, "usage: %s <jobs.txt> [--threads N]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<Job> jobs;
+    if (!load_jobs(jobs_path, jobs)) {
+        std::fprintf(stderr, "invalid job file: %s\n", jobs_path);
+        return 1;
+    }
+
+    std::vector<JobResult> results(jobs.size());
+    auto start = std::chrono::steady_clock::now();
+    WorkPool pool(threads);
+    for (size_t i = 0; i < jobs.size(); i++) {
+        pool.submit([&jobs, &results, i] { run_job(jobs[i], results[i]); });
+    }
+    pool.wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    uint64_t total_frames = 0;
+    std::printf("%-5s %-8s %8s %9s %9s %-16s %-16s %s\n",
+                "job", "status", "frames", "seconds", "fps", "ram_hash", "frame_hash", "rom");
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const JobResult& result = results[i];
+        if (result.error) {
+            std::printf("%-5zu %-8s %s: %s\n", i, "FAIL", jobs[i].rom.c_str(), result.error);
+            failed++;
+            continue;
+        }
+        total_frames += result.frames;
+        std::printf("%-5zu %-8s %8u %9.3f %9.1f %016llx %016llx %s\n", i, "ok", result.frames, result.seconds,
+                    result.seconds > 0.0 ? result.frames / result.seconds : 0.0,
+                    static_cast<unsigned long long>(result.ram_hash),
+                    static_cast<unsigned long long>(result.frame_hash), jobs[i].rom.c_str());
+    }
+
+    std::printf("jobs: %zu (%d failed), threads: %u, wall time: %.3f s, %.1f frames/second total\n",
+                jobs.size(), failed, pool.thread_count(), seconds, seconds > 0.0 ? total_frames / seconds : 0.0);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "machine.h"
+#include "runahead.h"
+#include "input_script.h"
+#include "palette.h"
+
+using namespace cnes;
+
+#ifndef CNES_BUILD_TYPE
+#define CNES_BUILD_TYPE "unknown"
+#endif
+
+namespace {
+
+// NTSC CPU主频
+constexpr double NTSC_CPU_MHZ = 1.789773;
+
+// 单次运行的统计结果
+struct PassResult {
+    double seconds = 0.0;
+    uint64_t cpu_cycles = 0;
+    uint64_t instructions = 0;
+    size_t state_bytes = 0;
+    double save_us = 0.0;      // 单次存档耗时
+    double load_us = 0.0;      // 单次读档耗时
+    double clone_us = 0.0;     // 单次复制机器耗时
+    double palette_us = 0.0;   // 一帧调色板转换耗时
+};
+
+// 在运行结束的状态上反复存档/读档/复制机器，取平均耗时
+void measure_state(Machine& machine, PassResult& result) {
+    constexpr int ROUNDS = 1000;
+    Bus& bus = machine.bus();
+    std::vector<uint8_t> buffer(bus.state_size());
+    result.state_bytes = buffer.size();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        bus.save_state(buffer.data(), buffer.size());
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        bus.load_state(buffer.data(), buffer.size());
+    }
+    auto end = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        machine.clone();
+    }
+    auto cloned = std::chrono::steady_clock::now();
+
+    result.save_us = std::chrono::duration<double, std::micro>(middle - start).count() / ROUNDS;
+    result.load_us = std::chrono::duration<double, std::micro>(end - middle).count() / ROUNDS;
+    result.clone_us = std::chrono::duration<double, std::micro>(cloned - end).count() / ROUNDS;
+
+    Palette palette;
+    std::vector<uint32_t> pixels(256 * 240);
+    auto converting = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        palette.convert(machine.screen(), machine.emphasis(), pixels.data());
+    }
+    auto converted = std::chrono::steady_clock::now();
+    result.palette_us = std::chrono::duration<double, std::micro>(converted - converting).count() / ROUNDS;
+}
+
+bool run_pass(const std::shared_ptr<const RomImage>& rom, uint32_t frames, uint32_t runahead,
+              InputScript script, BusProfile* profile, PassResult& result) {
+    std::unique_ptr<Machine> machine = Machine::create(rom);
+    if (!machine) {
+        return false;
+    }
+    Bus& bus = machine->bus();
+    bus.set_profile(profile);
+    RunAhead ahead(*machine, runahead);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        script.apply(bus, frame);
+        ahead.run_frame();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.cpu_cycles = bus.timestamp() / bus.ratio().cpu_divider;
+    result.instructions = machine->cpu().instruction_count();
+    measure_state(*machine, result);
+    return true;
+}
+
+void print_share(const char* name, uint64_t ns, uint64_t total_ns) {
+    double percent = total_ns ? 100.0 * ns / total_ns : 0.0;
+    std::printf("  %-4s %10.2f ms  %5.1f%%\n", name, ns / 1e6, percent);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // 位置参数：<rom.nes> [frames] [input_script]；--runahead N 额外测一遍预先运行N帧
+    std::vector<const char*> args;
+    uint32_t runahead = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--runahead") == 0 && i + 1 < argc) {
+            runahead = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.empty()) {
+        std::fprintf(stderr, "usage: %s <rom.nes> [frames] [input_script] [--runahead N]\n", argv[0]);
+        return 1;
+    }
+
+    const char* rom_path = args[0];
+    uint32_t frames = args.size() > 1 ? static_cast<uint32_t>(std::strtoul(args[1], nullptr, 10)) : 600;
+
+    // 两遍运行共享同一个ROM映像
+    std::shared_ptr<const RomImage> rom = RomImage::open(rom_path);
+    if (!rom) {
+        std::fprintf(stderr, "cannot open ROM: %s\n", rom_path);
+        return 1;
+    }
+
+    InputScript script;
+    if (args.size() > 2 && !script.load(args[2])) {
+        std::fprintf(stderr, "invalid input script: %s\n", args[2]);
+        return 1;
+    }
+
+    // 第一遍不计时各组件，得到可比较的总体数据
+    PassResult result;
+    if (!run_pass(rom, frames, 0, script, nullptr, result)) {
+        std::fprintf(stderr, "ROM load fail: %s\n", rom_path);
+        return 1;
+    }
+
+    // 第二遍统计各组件耗时（含计时开销，只看占比）
+    BusProfile profile;
+    PassResult profiled;
+    run_pass(rom, frames, 0, script, &profile, profiled);
+
+    // 预先运行：与第一遍相比多出的时间平摊到每个额外模拟的帧
+    PassResult ahead;
+    if (runahead > 0) {
+        run_pass(rom, frames, runahead, script, nullptr, ahead);
+    }
+
+    double mhz = result.cpu_cycles / result.seconds / 1e6;
+    std::printf("rom:            %s\n", rom_path);
+    std::printf("build:          %s\n", CNES_BUILD_TYPE);
+    std::printf("frames:         %u\n", frames);
+    std::printf("wall time:      %.3f s\n", result.seconds);
+    std::printf("emulated CPU:   %.2f MHz (%.1fx real time)\n", mhz, mhz / NTSC_CPU_MHZ);
+    std::printf("frames/second:  %.1f\n", frames / result.seconds);
+    std::printf("instructions:   %llu (%.2f ns/instruction)\n",
+                static_cast<unsigned long long>(result.instructions),
+                result.instructions ? result.seconds * 1e9 / result.instructions : 0.0);
+
+    if (runahead > 0) {
+        double extra_ms = (ahead.seconds - result.seconds) * 1e3 / (static_cast<double>(frames) * runahead);
+        std::printf("run-ahead:      %u frames, %.1f frames/second (%.3f ms per extra frame)\n",
+                    runahead, frames / ahead.seconds, extra_ms);
+    }
+    std::printf("save state:     %zu bytes (save %.2f us, load %.2f us)\n",
+                result.state_bytes, result.save_us, result.load_us);
+    std::printf("clone:          %.2f us\n", result.clone_us);
+    std::printf("palette:        %s, %.2f us/frame\n", Palette::kernel_name(Palette::kernel()), result.palette_us);
+
+    uint64_t total_ns = static_cast<uint64_t>(profiled.seconds * 1e9);
+    uint64_t other_ns = profile.ppu_ns + profile.apu_ns + profile.dma_ns;
+    uint64_t cpu_ns = total_ns > other_ns ? total_ns - other_ns : 0;
+    std::printf("breakdown (profiled pass):\n");
+    print_share("CPU", cpu_ns, total_ns);
+    print_share("PPU", profile.ppu_ns, total_ns);
+    print_share("APU", profile.apu_ns, total_ns);
+    print_share("DMA", profile.dma_ns, total_ns);
+
+    return 0;
+}
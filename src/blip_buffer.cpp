@@ -0,0 +1,124 @@
+#include "blip_buffer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace cnes {
+
+namespace {
+
+// 截止频率（相对输出采样率），略低于奈奎斯特频率
+constexpr double CUTOFF = 0.45;
+
+// 去直流的高通截止频率（Hz）
+constexpr double DC_CUTOFF = 20.0;
+
+constexpr double PI = 3.14159265358979323846;
+
+// 各小数相位的带限冲激（Blackman窗sinc），每个相位的系数和为1，积分后正好是一个单位阶跃
+template <int PHASES, int WIDTH>
+struct Kernel {
+    std::array<std::array<float, WIDTH>, PHASES> taps;
+
+    Kernel() {
+        const double half = WIDTH / 2;
+        for (int phase = 0; phase < PHASES; phase++) {
+            double fraction = static_cast<double>(phase) / PHASES;
+            double sum = 0.0;
+            std::array<double, WIDTH> values;
+            for (int k = 0; k < WIDTH; k++) {
+                double x = k - half - fraction;
+                double sinc = x == 0.0 ? 1.0 : std::sin(2.0 * PI * CUTOFF * x) / (2.0 * PI * CUTOFF * x);
+                double window = std::fabs(x) >= half ? 0.0
+                    : 0.42 + 0.5 * std::cos(PI * x / half) + 0.08 * std::cos(2.0 * PI * x / half);
+                values[k] = sinc * window;
+                sum += values[k];
+            }
+            for (int k = 0; k < WIDTH; k++) {
+                taps[phase][k] = static_cast<float>(values[k] / sum);
+            }
+        }
+    }
+};
+
+} // namespace
+
+void BlipBuffer::set_rates(double clock_rate, double sample_rate, uint32_t max_frame) {
+    factor_ = static_cast<uint64_t>(sample_rate / clock_rate * (1ull << FRACTION_BITS));
+    dc_coefficient_ = static_cast<float>(1.0 - std::exp(-2.0 * PI * DC_CUTOFF / sample_rate));
+
+    // 未读出的采样最多保留约半秒，加上一帧和冲激宽度的余量
+    size_t frame_samples = static_cast<size_t>(max_frame * sample_rate / clock_rate) + 1;
+    buffer_.assign(static_cast<size_t>(sample_rate / 2) + frame_samples + KERNEL_WIDTH + 1, 0.0f);
+    clear();
+}
+
+void BlipBuffer::clear() {
+    offset_ = 0;
+    available_ = 0;
+    extent_ = 0;
+    integrator_ = 0.0f;
+    dc_ = 0.0f;
+    std::fill(buffer_.begin(), buffer_.end(), 0.0f);
+}
+
+void BlipBuffer::add_delta(uint32_t time, float delta) {
+    static const Kernel<PHASES, KERNEL_WIDTH> kernel;
+
+    uint64_t position = time * factor_ + offset_;
+    size_t index = available_ + static_cast<size_t>(position >> FRACTION_BITS);
+    if (index + KERNEL_WIDTH > buffer_.size()) {
+        return;
+    }
+    uint32_t phase = static_cast<uint32_t>(position >> (FRACTION_BITS - PHASE_BITS)) & (PHASES - 1);
+    const auto& taps = kernel.taps[phase];
+    float* out = &buffer_[index];
+    extent_ = std::max(extent_, index + KERNEL_WIDTH);
+    for (int k = 0; k < KERNEL_WIDTH; k++) {
+        out[k] += taps[k] * delta;
+    }
+}
+
+void BlipBuffer::end_frame(uint32_t time) {
+    if (!enabled()) {
+        return;
+    }
+    uint64_t position = time * factor_ + offset_;
+    available_ += static_cast<size_t>(position >> FRACTION_BITS);
+    offset_ = position & ((1ull << FRACTION_BITS) - 1);
+
+    // 没有及时读出时丢掉积压的采样，保证下一帧放得下
+    size_t limit = buffer_.size() - buffer_.size() / 4;
+    if (available_ > limit) {
+        size_t drop = available_ - limit / 2;
+        for (size_t i = 0; i < drop; i++) {
+            integrator_ += buffer_[i];
+        }
+        discard(drop);
+    }
+}
+
+size_t BlipBuffer::read_samples(int16_t* out, size_t count) {
+    count = std::min(count, available_);
+    for (size_t i = 0; i < count; i++) {
+        integrator_ += buffer_[i];
+        dc_ += (integrator_ - dc_) * dc_coefficient_;
+        float sample = (integrator_ - dc_) * 32767.0f;
+        out[i] = static_cast<int16_t>(std::max(-32768.0f, std::min(32767.0f, sample)));
+    }
+
+    discard(count);
+    return count;
+}
+
+void BlipBuffer::discard(size_t count) {
+    // 剩余的采样和还在叠加中的冲激尾部移到开头
+    size_t end = std::max(extent_, available_);
+    std::memmove(buffer_.data(), buffer_.data() + count, (end - count) * sizeof(float));
+    std::fill(buffer_.begin() + (end - count), buffer_.begin() + end, 0.0f);
+    available_ -= count;
+    extent_ = end - count;
+}
+
+} // namespace cnes
@@ -0,0 +1,55 @@
+#ifndef CNES_BLIP_BUFFER_H
+#define CNES_BLIP_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cnes {
+
+// 带限阶跃合成缓冲
+// 声道只在输出电平变化时登记一次幅度差（时间以输入时钟计），缓冲中叠加对应小数相位的
+// 带限冲激，读出时积分得到阶跃并去除直流。输入时钟到输出采样率的重采样同时完成，
+// 不需要按输入时钟逐周期采样
+class BlipBuffer {
+public:
+    // 设置输入时钟频率和输出采样率，max_frame为两次end_frame之间最多的输入时钟数
+    void set_rates(double clock_rate, double sample_rate, uint32_t max_frame);
+    bool enabled() const { return factor_ != 0; }
+
+    // 丢弃所有未读出的数据
+    void clear();
+
+    // 在本帧time时刻（输入时钟）加入幅度差delta
+    void add_delta(uint32_t time, float delta);
+
+    // 结束本帧：time之前的采样变为可读，之后的时间从0重新计
+    void end_frame(uint32_t time);
+
+    size_t samples_available() const { return available_; }
+
+    // 读出最多count个16位采样，返回实际个数
+    size_t read_samples(int16_t* out, size_t count);
+
+private:
+    void discard(size_t count);
+
+    static constexpr int HALF_WIDTH = 8;               // 冲激单侧宽度（采样）
+    static constexpr int KERNEL_WIDTH = HALF_WIDTH * 2;
+    static constexpr int PHASE_BITS = 6;
+    static constexpr int PHASES = 1 << PHASE_BITS;
+    static constexpr int FRACTION_BITS = 32;
+
+    uint64_t factor_ = 0;       // 每个输入时钟对应的采样数（32位小数定点）
+    uint64_t offset_ = 0;       // 本帧起点的采样位置小数部分
+    size_t available_ = 0;
+    size_t extent_ = 0;         // 已写入冲激的末尾
+    std::vector<float> buffer_;
+    float integrator_ = 0.0f;
+    float dc_ = 0.0f;           // 直流分量估计
+    float dc_coefficient_ = 0.0f;
+};
+
+} // namespace cnes
+
+#endif // CNES_BLIP_BUFFER_H
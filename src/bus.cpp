@@ -1,107 +1,453 @@
 #include "bus.h"
 #include "cartridge.h"
+#include "state.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 namespace cnes {
 
 Bus::Bus() {
+    // $0000-$1FFF：2KB系统RAM，每2KB镜像
+    for (uint16_t addr = 0x0000; addr < 0x2000; addr += 0x0800) {
+        pages_.map_memory(addr, 0x0800, ram_.data(), ram_.data());
+    }
+    pages_.map_handler(0x2000, 0x2000, PageTable::PPU_REGISTERS);
+    pages_.map_handler(0x4000, 0x0100, PageTable::IO_REGISTERS);
+    pages_.map_handler(0x4100, 0xBF00, PageTable::CARTRIDGE);
 }
 
-void Bus::write(uint16_t addr, uint8_t data) {
- 
-  if (cartridge_ && cartridge_->cpu_write(addr, data)) {
-  }
-  else if (addr >= 0x0000 && addr <= 0x1FFF) {
-      // 系统RAM，每2KB镜像
-      ram_[addr & 0x07FF] = data;
-  }
-  else if (addr >= 0x2000 && addr <= 0x3FFF) {
-      // PPU寄存器，每8字节镜像
-      ppu_->write_register(0x2000 + (addr & 0x7), data);
-  }
-  else if (addr >= 0x4000 && addr <= 0x4013) {
-      // APU寄存器
-      apu_->write_register(addr, data);
-  }
-  else if (addr == 0x4014) {
-      // PPU DMA
-      dma_page_ = data;
-      dma_transfer_ = true;
-  }
-  else if (addr == 0x4015) {
-      // APU状态
-      apu_->write_register(addr, data);
-  }
-}
-
-uint8_t Bus::read(uint16_t addr) {
-    uint8_t data = 0x00;
+void Bus::connect_cartridge(Cartridge* cartridge) {
+    cartridge_ = cartridge;
+    cartridge_->connect_pages(&pages_);
+    if (ppu_) {
+        ppu_->connect_cartridge(cartridge_);
+    }
+}
+
+void Bus::write_io(uint16_t addr, uint8_t data, PageTable::HANDLER handler) {
+    switch (handler) {
+        case PageTable::PPU_REGISTERS:
+            // PPU寄存器，每8字节镜像；没有PPU时为开放总线
+            if (!ppu_) {
+                break;
+            }
+            sync_ppu(cpu_clock_ + ratio_.ppu_divider);
+            ppu_->write_register(0x2000 + (addr & 0x7), data);
+            if ((addr & 0x7) == 0x1) {
+                // 渲染开关影响奇数帧是否跳过一个点和Mapper扫描线计数
+                schedule_vblank();
+                schedule_mapper_irq();
+            }
+            poll_interrupts();
+            break;
 
-    if (cartridge_ && cartridge_->cpu_read(addr, data)) {
-        // 从卡带读取
+        case PageTable::IO_REGISTERS:
+            if (addr <= 0x4013 || addr == 0x4015 || addr == 0x4017) {
+                // APU寄存器/APU状态/帧计数器，先让APU追上当前时间
+                sync_apu(cpu_clock_);
+                apu_->write_register(addr, data);
+                schedule_apu_irq();
+                poll_interrupts();
+            }
+            else if (addr == 0x4016) {
+                // 手柄选通，高电平期间持续重新锁存按键
+                controller_strobe_ = data & 0x01;
+                if (controller_strobe_) {
+                    controller_shift_ = controller_state_;
+                }
+            }
+            else if (addr == 0x4014) {
+                // PPU DMA
+                dma_page_ = data;
+                dma_transfer_ = true;
+            }
+            else if (addr >= 0x4020 && cartridge_) {
+                write_cartridge(addr, data);
+            }
+            break;
+
+        case PageTable::CARTRIDGE:
+            if (cartridge_) {
+                write_cartridge(addr, data);
+            }
+            break;
+
+        default:
+            break;
     }
-    else if (addr >= 0x0000 && addr <= 0x1FFF) {
-        // 系统RAM
-        data = ram_[addr & 0x07FF];
+}
+
+void Bus::write_cartridge(uint16_t addr, uint8_t data) {
+    // Mapper寄存器会切换CHR bank、镜像和IRQ计数器，先让PPU追上当前时间；
+    // 切换PRG bank会影响DMC读取的样本，APU也要先追上
+    sync_ppu(cpu_clock_ + ratio_.ppu_divider);
+    sync_apu(cpu_clock_);
+    cartridge_->cpu_write(addr, data);
+    if (ppu_) {
+        ppu_->update_mirroring();
     }
-    else if (addr >= 0x2000 && addr <= 0x3FFF) {
-        // PPU寄存器
-        data = ppu_->read_register(0x2000 + (addr & 0x7));
+    schedule_mapper_irq();
+    poll_interrupts();
+}
+
+uint8_t Bus::read_io(uint16_t addr, PageTable::HANDLER handler) {
+    uint8_t data = 0x00;
+
+    switch (handler) {
+        case PageTable::PPU_REGISTERS:
+            if (!ppu_) {
+                break;
+            }
+            sync_ppu(cpu_clock_ + ratio_.ppu_divider);
+            data = ppu_->read_register(0x2000 + (addr & 0x7));
+            poll_interrupts();
+            break;
+
+        case PageTable::IO_REGISTERS:
+            if (addr <= 0x4013 || addr == 0x4015) {
+                // APU寄存器/APU状态（读取清除帧IRQ）
+                sync_apu(cpu_clock_);
+                data = apu_->read_register(addr);
+                schedule_apu_irq();
+                poll_interrupts();
+            }
+            else if (addr == 0x4016 || addr == 0x4017) {
+                data = read_controller(addr & 0x01);
+            }
+            else if (addr >= 0x4020 && cartridge_) {
+                cartridge_->cpu_read(addr, data);
+            }
+            break;
+
+        case PageTable::CARTRIDGE:
+            if (cartridge_) {
+                cartridge_->cpu_read(addr, data);
+            }
+            break;
+
+        default:
+            break;
     }
-    else if (addr >= 0x4000 && addr <= 0x4013) {
-        // APU寄存器
-        data = apu_->read_register(addr);
+
+    return data;
+}
+
+uint8_t Bus::peek(uint16_t addr) const {
+    const PageTable::Page& page = pages_[addr >> 8];
+    uint8_t data = 0x00;
+    if (page.read) {
+        data = page.read[addr & 0xFF];
     }
-    else if (addr == 0x4015) {
-        // APU状态
-        data = apu_->read_register(addr);
+    else if (page.handler == PageTable::CARTRIDGE && cartridge_) {
+        cartridge_->cpu_read(addr, data);
     }
-
     return data;
 }
 
+uint8_t Bus::read_controller(uint8_t port) {
+    if (controller_strobe_) {
+        controller_shift_[port] = controller_state_[port];
+    }
+
+    // 依次移出A、B、Select、Start、上、下、左、右，读完8位后返回1
+    uint8_t data = controller_shift_[port] & 0x01;
+    controller_shift_[port] = (controller_shift_[port] >> 1) | 0x80;
+    return data | 0x40;
+}
+
 void Bus::clock() {
-    ppu_->clock();
-    
-    if (system_clock_counter_ % 3 == 0) {
-        if (dma_transfer_) {
-            dma_execute();
+    run_until(timestamp_ + ratio_.ppu_divider);
+}
+
+void Bus::skip_until(uint64_t timestamp) {
+    // 到期的事件照常处理，CPU时钟按整周期跳过
+    Scheduler::EVENT event;
+    uint64_t event_deadline;
+    while (scheduler_.pop_due(timestamp, event, event_deadline)) {
+        service_event(event, event_deadline);
+    }
+    if (cpu_clock_ < timestamp) {
+        cpu_clock_ += (timestamp - cpu_clock_ + ratio_.cpu_divider - 1) / ratio_.cpu_divider * ratio_.cpu_divider;
+    }
+
+    sync_ppu(timestamp);
+    poll_interrupts();
+    timestamp_ = timestamp;
+}
+
+void Bus::run_until(uint64_t timestamp) {
+    for (;;) {
+        // CPU自由运行到最近的截止时间
+        uint64_t deadline = std::min(timestamp, scheduler_.next_deadline());
+        while (cpu_clock_ < deadline) {
+            uint64_t cycles;
+            if (dma_active_) {
+                // DMA期间CPU暂停，直接跳到截止时间所在的周期
+                cycles = (deadline - cpu_clock_ + ratio_.cpu_divider - 1) / ratio_.cpu_divider;
+            }
+            else {
+                cycles = cpu_->step();
+            }
+
+            cpu_clock_ += cycles * ratio_.cpu_divider;
+
+            if (dma_transfer_) {
+                start_dma();
+            }
+            deadline = std::min(timestamp, scheduler_.next_deadline());
+        }
+
+        // 处理已到期的事件
+        Scheduler::EVENT event;
+        uint64_t event_deadline;
+        if (!scheduler_.pop_due(timestamp, event, event_deadline)) {
+            break;
+        }
+        service_event(event, event_deadline);
+    }
+
+    sync_ppu(timestamp);
+    poll_interrupts();
+    timestamp_ = timestamp;
+}
+
+uint32_t Bus::run_cycles(uint32_t cycles) {
+    run_until(timestamp_ + static_cast<uint64_t>(cycles) * ratio_.cpu_divider);
+    return cycles;
+}
+
+void Bus::run_frame() {
+    ppu_->clear_frame_complete();
+    while (!ppu_->frame_complete()) {
+        run_until(scheduler_.deadline(Scheduler::PPU_VBLANK) + ratio_.ppu_divider);
+    }
+}
+
+void Bus::sync_ppu(uint64_t timestamp) {
+    if (ppu_ && ppu_clock_ < timestamp) {
+        uint64_t dots = (timestamp - ppu_clock_ + ratio_.ppu_divider - 1) / ratio_.ppu_divider;
+        if (profile_) {
+            auto start = std::chrono::steady_clock::now();
+            ppu_->run(static_cast<uint32_t>(dots));
+            profile_->ppu_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
         }
         else {
-            cpu_->clock();
+            ppu_->run(static_cast<uint32_t>(dots));
         }
+        ppu_clock_ += dots * ratio_.ppu_divider;
     }
+}
+
+void Bus::sync_apu(uint64_t timestamp) {
+    if (apu_clock_ + ratio_.cpu_divider <= timestamp) {
+        uint64_t cycles = (timestamp - apu_clock_) / ratio_.cpu_divider;
+        if (profile_) {
+            auto start = std::chrono::steady_clock::now();
+            apu_->run(static_cast<uint32_t>(cycles));
+            profile_->apu_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+        else {
+            apu_->run(static_cast<uint32_t>(cycles));
+        }
+        apu_clock_ += cycles * ratio_.cpu_divider;
+    }
+}
+
+void Bus::set_audio_output(bool enabled) {
+    sync_apu(timestamp_);
+    apu_->set_output(enabled);
+}
+
+size_t Bus::read_samples(int16_t* out, size_t count) {
+    sync_apu(timestamp_);
+    return apu_->read_samples(out, count);
+}
+
+void Bus::service_event(Scheduler::EVENT event, uint64_t deadline) {
+    switch (event) {
+        case Scheduler::PPU_VBLANK:
+            // 处理vblank开始的那个点，NMI在下一条指令前响应
+            sync_ppu(deadline + ratio_.ppu_divider);
+            poll_interrupts();
+            schedule_vblank();
+            break;
+        case Scheduler::DMA_DONE:
+            dma_active_ = false;
+            break;
+        case Scheduler::APU_FRAME:
+            sync_apu(deadline);
+            poll_interrupts();
+            schedule_apu_irq();
+            break;
+        case Scheduler::MAPPER_IRQ:
+            // 处理计数器归零的那个点，IRQ在下一条指令前响应
+            sync_ppu(deadline + ratio_.ppu_divider);
+            poll_interrupts();
+            schedule_mapper_irq();
+            break;
+        default:
+            break;
+    }
+}
+
+void Bus::schedule_vblank() {
+    if (!ppu_) {
+        scheduler_.cancel(Scheduler::PPU_VBLANK);
+        return;
+    }
+    scheduler_.schedule(Scheduler::PPU_VBLANK,
+                        ppu_clock_ + static_cast<uint64_t>(ppu_->dots_until_vblank()) * ratio_.ppu_divider);
+}
+
+void Bus::schedule_mapper_irq() {
+    // 计数器只在渲染开启时计数，关闭渲染时不登记事件
+    int32_t lines = cartridge_ ? cartridge_->scanlines_until_irq() : -1;
+    if (lines < 0 || !ppu_ || !ppu_->rendering_enabled()) {
+        scheduler_.cancel(Scheduler::MAPPER_IRQ);
+        return;
+    }
+    scheduler_.schedule(Scheduler::MAPPER_IRQ,
+                        ppu_clock_ + static_cast<uint64_t>(ppu_->dots_until_mapper_clock(lines)) * ratio_.ppu_divider);
+}
 
-    if (system_clock_counter_ % 2 == 0) {
-        apu_->clock();
+void Bus::schedule_apu_irq() {
+    int32_t cycles = apu_->cycles_until_irq();
+    if (cycles < 0) {
+        scheduler_.cancel(Scheduler::APU_FRAME);
+        return;
     }
+    scheduler_.schedule(Scheduler::APU_FRAME, apu_clock_ + static_cast<uint64_t>(cycles) * ratio_.cpu_divider);
+}
 
-    system_clock_counter_++;
+void Bus::poll_interrupts() {
+    if (ppu_ && ppu_->nmi()) {
+        ppu_->clear_nmi();
+        cpu_->request_nmi();
+    }
+    cpu_->set_irq(CPU::IRQ_MAPPER, cartridge_ && cartridge_->irq_state());
+    cpu_->set_irq(CPU::IRQ_APU, apu_->irq());
+}
+
+void Bus::set_region(Region region) {
+    region_ = region;
+    ratio_ = clock_ratio(region);
+    if (ppu_) {
+        ppu_->set_region(region);
+    }
+    apu_->set_region(region);
 }
 
 void Bus::reset() {
-    system_clock_counter_ = 0;
+    timestamp_ = 0;
+    cpu_clock_ = 0;
+    ppu_clock_ = 0;
+    apu_clock_ = 0;
     dma_transfer_ = false;
+    dma_active_ = false;
+    controller_shift_ = {};
+    controller_strobe_ = false;
+    scheduler_.reset();
     cpu_->reset();
-    ppu_->reset();
+    if (ppu_) {
+        ppu_->reset();
+    }
     apu_->reset();
+    schedule_vblank();
+    schedule_mapper_irq();
+    schedule_apu_irq();
+}
+
+size_t Bus::state_size() const {
+    StateStream state;
+    serialize(state);
+    return sizeof(StateHeader) + state.position();
 }
 
-void Bus::dma_write(uint8_t data) {
-    dma_data_ = data;
+bool Bus::save_state(uint8_t* data, size_t size) {
+    // APU平时滞后，存档前推进到当前时间，同一时刻的存档内容与何时同步过无关
+    sync_apu(timestamp_);
+    return snapshot(data, size);
 }
 
-void Bus::dma_execute() {
-    if (system_clock_counter_ % 2 == 0) {
-        dma_data_ = read(dma_page_ << 8 | dma_addr_);
+bool Bus::snapshot(uint8_t* data, size_t size) const {
+    size_t total = state_size();
+    if (size < total) {
+        return false;
     }
-    else {
-        ppu_->write_register(0x2004, dma_data_);
-        
-        dma_addr_++;
-        if (dma_addr_ == 0x00) {
-            dma_transfer_ = false;
-        }
+
+    StateHeader header{{'C', 'N', 'S', 'T'}, STATE_VERSION, static_cast<uint32_t>(total),
+                       static_cast<uint8_t>(cartridge_ ? cartridge_->mapper_id() : 0), {}};
+    std::memcpy(data, &header, sizeof(header));
+
+    StateStream state(data + sizeof(header), total - sizeof(header));
+    serialize(state);
+    return state.ok();
+}
+
+bool Bus::load_state(const uint8_t* data, size_t size) {
+    // 先校验文件头，确认布局一致后再写入各组件
+    StateHeader header;
+    size_t total = state_size();
+    if (size < total) {
+        return false;
     }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, "CNST", 4) != 0 || header.version != STATE_VERSION ||
+        header.size != total || header.mapper_id != (cartridge_ ? cartridge_->mapper_id() : 0)) {
+        return false;
+    }
+
+    StateStream state(data + sizeof(header), total - sizeof(header));
+    serialize(state);
+    return state.ok();
+}
+
+void Bus::serialize(StateStream& state) {
+    state(ram_);
+    state(dma_transfer_);
+    state(dma_active_);
+    state(dma_page_);
+    state(controller_state_);
+    state(controller_shift_);
+    state(controller_strobe_);
+    state(timestamp_);
+    state(cpu_clock_);
+    state(ppu_clock_);
+    state(apu_clock_);
+    scheduler_.serialize(state);
+
+    // 卡带在PPU之前，PPU读取后按Mapper的镜像模式重建名称表映射
+    cpu_->serialize(state);
+    if (cartridge_) {
+        cartridge_->serialize(state);
+    }
+    if (ppu_) {
+        ppu_->serialize(state);
+    }
+    apu_->serialize(state);
+}
+
+void Bus::start_dma() {
+    dma_transfer_ = false;
+
+    // 整页一次性写入OAM，CPU随后暂停513个周期（从偶数周期开始时为514个）
+    sync_ppu(cpu_clock_ + ratio_.ppu_divider);
+    auto start = profile_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    for (uint16_t i = 0; i < 256 && ppu_; i++) {
+        ppu_->write_register(0x2004, read(dma_page_ << 8 | i));
+    }
+    if (profile_) {
+        profile_->dma_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    uint64_t cycles = 513 + (((cpu_clock_ / ratio_.cpu_divider) & 1) == 0 ? 1 : 0);
+    dma_active_ = true;
+    scheduler_.schedule(Scheduler::DMA_DONE, cpu_clock_ + cycles * ratio_.cpu_divider);
 }
 
 } // namespace cnes
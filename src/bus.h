@@ -1,26 +1,48 @@
 #ifndef CNES_BUS_H
 #define CNES_BUS_H
 
+#include <cstddef>
 #include <cstdint>
 #include <array>
 #include "cpu.h"
 #include "ppu.h"
 #include "apu.h"
+#include "scheduler.h"
+#include "page_table.h"
 
 namespace cnes {
 
 class Cartridge;
+class StateStream;
+
+// 手柄按键（$4016/$4017串行读出顺序）
+enum BUTTON : uint8_t {
+    BUTTON_A      = (1 << 0),
+    BUTTON_B      = (1 << 1),
+    BUTTON_SELECT = (1 << 2),
+    BUTTON_START  = (1 << 3),
+    BUTTON_UP     = (1 << 4),
+    BUTTON_DOWN   = (1 << 5),
+    BUTTON_LEFT   = (1 << 6),
+    BUTTON_RIGHT  = (1 << 7),
+};
+
+// 各组件耗时统计，连接后才计时
+struct BusProfile {
+    uint64_t ppu_ns = 0;
+    uint64_t apu_ns = 0;
+    uint64_t dma_ns = 0;
+};
 
 // 系统总线
+// 可以不连接PPU（NSF播放）：PPU寄存器为开放总线，不登记vblank事件，只能用run_until()等按时间运行
 class Bus {
 public:
     Bus();
     ~Bus() = default;
 
     // 组件连接
-    void connect_cartridge(Cartridge* cartridge) { 
-      cartridge_ = cartridge; 
-    }
+    void connect_cartridge(Cartridge* cartridge);
 
     void connect_cpu(CPU* cpu) { 
       cpu_ = cpu; 
@@ -30,6 +52,9 @@ public:
     void connect_ppu(PPU* ppu) { 
       ppu_ = ppu; 
       ppu_->connect_bus(this);
+      if (cartridge_) {
+        ppu_->connect_cartridge(cartridge_);
+      }
     }
 
     void connect_apu(APU* apu) { 
@@ -37,17 +62,71 @@ public:
       apu_->connect_bus(this);
     }
 
-    // 总线操作
-    void write(uint16_t addr, uint8_t data);
-    uint8_t read(uint16_t addr);
+    // 总线操作：RAM/ROM页直接访问，I/O页交给处理器
+    void write(uint16_t addr, uint8_t data) {
+        const PageTable::Page& page = pages_[addr >> 8];
+        if (page.write) {
+            page.write[addr & 0xFF] = data;
+            return;
+        }
+        write_io(addr, data, page.handler);
+    }
+
+    uint8_t read(uint16_t addr) {
+        const PageTable::Page& page = pages_[addr >> 8];
+        if (page.read) {
+            return page.read[addr & 0xFF];
+        }
+        return read_io(addr, page.handler);
+    }
+
+    // 2KB工作RAM（导出观测数据用）
+    const std::array<uint8_t, 2048>& ram() const { return ram_; }
+
+    // 无副作用地读取（跟踪/调试用），I/O寄存器返回0
+    uint8_t peek(uint16_t addr) const;
 
     // 系统操作
-    void clock();    // 系统时钟
+    void clock();    // 系统时钟（一个PPU点）
     void reset();    // 系统重置
+    void set_region(Region region);    // 设置制式，需在reset()之前调用
+    Region region() const { return region_; }
 
-    // DMA传输
-    void dma_write(uint8_t data);
-    void dma_execute();
+    // 追赶式运行：CPU自由运行到最近的事件截止时间，PPU在访问寄存器或事件到期时追赶
+    void run_until(uint64_t timestamp);     // 运行到主时钟时间戳
+    uint32_t run_cycles(uint32_t cycles);   // 运行cycles个CPU周期
+    void run_frame();                       // 运行到PPU完成一帧（需要PPU）
+
+    // CPU停在无副作用的空循环时使用：不执行指令，直接推进到timestamp，期间到期的事件照常处理
+    void skip_until(uint64_t timestamp);
+
+    // 当前主时钟时间戳
+    uint64_t timestamp() const { return timestamp_; }
+    const ClockRatio& ratio() const { return ratio_; }
+
+    // 设置手柄当前按下的按键（port 0/1）
+    void set_controller(uint8_t port, uint8_t buttons) { controller_state_[port & 1] = buttons; }
+    uint8_t controller(uint8_t port) const { return controller_state_[port & 1]; }
+
+    // 存档：所有组件按固定布局写入一块连续内存，保存和读取都不分配内存
+    // 格式为StateHeader加各组件字段，布局随版本号变化，同一ROM的大小固定
+    static constexpr uint32_t STATE_VERSION = 3;
+    size_t state_size() const;
+    bool save_state(uint8_t* data, size_t size);
+
+    // 与save_state()相同，但不先推进APU，不修改任何组件，多个线程可同时对同一台机器调用
+    // 读取后APU同样滞后，之后按需追赶，结果与原机器一致
+    bool snapshot(uint8_t* data, size_t size) const;
+    bool load_state(const uint8_t* data, size_t size);   // 版本、大小或Mapper不符时返回false且不修改状态
+
+    // 把APU推进到当前时间后读出已合成的声音采样
+    size_t read_samples(int16_t* out, size_t count);
+
+    // 开关声音合成（预先运行用），先把APU推进到当前时间，之前的声音照常保留
+    void set_audio_output(bool enabled);
+
+    // 组件耗时统计，传入nullptr关闭
+    void set_profile(BusProfile* profile) { profile_ = profile; }
 
 private:
     // 系统组件
@@ -59,14 +138,59 @@ private:
     // 系统RAM
     std::array<uint8_t, 2048> ram_{};
 
+    // CPU页表
+    PageTable pages_;
+    void write_io(uint16_t addr, uint8_t data, PageTable::HANDLER handler);
+    uint8_t read_io(uint16_t addr, PageTable::HANDLER handler);
+
+    // 存档头
+    struct StateHeader {
+        char magic[4];        // CNST
+        uint32_t version;     // STATE_VERSION
+        uint32_t size;        // 包含文件头的总大小
+        uint8_t mapper_id;
+        uint8_t padding[3];
+    };
+    void serialize(StateStream& state);
+
+    // 计算大小和保存时serialize()只读取字段
+    void serialize(StateStream& state) const { const_cast<Bus*>(this)->serialize(state); }
+
+    // 组件同步
+    void sync_ppu(uint64_t timestamp);
+    void service_event(Scheduler::EVENT event, uint64_t deadline);
+    void schedule_vblank();
+    void schedule_mapper_irq();
+    void schedule_apu_irq();
+    void sync_apu(uint64_t timestamp);
+    void write_cartridge(uint16_t addr, uint8_t data);
+    void poll_interrupts();
+
+    // DMA传输
+    void start_dma();
+
     // DMA状态
-    bool dma_transfer_ = false;
+    bool dma_transfer_ = false;    // $4014已写入，等待当前指令结束
+    bool dma_active_ = false;      // DMA进行中，CPU暂停
     uint8_t dma_page_ = 0x00;
-    uint8_t dma_addr_ = 0x00;
-    uint8_t dma_data_ = 0x00;
 
-    // 系统时钟计数
-    uint32_t system_clock_counter_ = 0;
+    // 手柄
+    std::array<uint8_t, 2> controller_state_{};   // 当前按键
+    std::array<uint8_t, 2> controller_shift_{};   // 移位寄存器
+    bool controller_strobe_ = false;
+    uint8_t read_controller(uint8_t port);
+
+    // 耗时统计
+    BusProfile* profile_ = nullptr;
+
+    // 事件调度与时钟
+    Scheduler scheduler_;
+    Region region_ = Region::NTSC;
+    ClockRatio ratio_ = clock_ratio(Region::NTSC);
+    uint64_t timestamp_ = 0;       // 系统已推进到的主时钟
+    uint64_t cpu_clock_ = 0;       // CPU下一条指令开始的主时钟（可领先于timestamp_）
+    uint64_t ppu_clock_ = 0;       // PPU下一个待处理点的主时钟
+    uint64_t apu_clock_ = 0;       // APU已推进到的主时钟（只在需要时追赶）
 };
 
 } // namespace cnes
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "machine.h"
+#include "media_writer.h"
+#include "movie.h"
+
+using namespace cnes;
+
+namespace {
+
+constexpr uint32_t SAMPLE_RATE = 48000;
+
+} // namespace
+
+// 无界面全速回放录像，把声音写成WAV、画面写成Y4M或RGB24原始流（"-"为标准输出，可接编码器）
+int main(int argc, char* argv[]) {
+    const char* wav_path = nullptr;
+    const char* video_path = nullptr;
+    const char* palette_path = nullptr;
+    bool raw_video = false;
+    std::vector<const char*> args;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+            wav_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--video") == 0 && i + 1 < argc) {
+            video_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--rgb") == 0) {
+            raw_video = true;
+        }
+        else if (std::strcmp(argv[i], "--palette") == 0 && i + 1 < argc) {
+            palette_path = argv[++i];
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() < 2 || (!wav_path && !video_path)) {
+        std::fprintf(stderr, "usage: %s <rom.nes> <movie.cnm> [--wav out.wav] [--video out.y4m|out.rgb|-] "
+                     "[--rgb] [--palette file.pal]\n", argv[0]);
+        return 1;
+    }
+
+    std::shared_ptr<const RomImage> rom = RomImage::open(args[0]);
+    if (!rom) {
+        std::fprintf(stderr, "cannot open ROM: %s\n", args[0]);
+        return 1;
+    }
+
+    Movie movie;
+    std::string error;
+    Movie::LOAD_RESULT loaded = movie.load_for(args[1], *rom, &error);
+    if (loaded != Movie::LOADED) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return loaded == Movie::ROM_MISMATCH ? 2 : 1;
+    }
+
+    std::unique_ptr<Machine> machine = Machine::create(rom);
+    if (!machine) {
+        std::fprintf(stderr, "ROM load fail: %s\n", args[0]);
+        return 1;
+    }
+    Bus& bus = machine->bus();
+
+    // 写到标准输出时统计信息改到标准错误，以免混进数据流
+    bool piped = (wav_path && std::strcmp(wav_path, "-") == 0) || (video_path && std::strcmp(video_path, "-") == 0);
+    std::FILE* report = piped ? stderr : stdout;
+
+    WavWriter wav(SAMPLE_RATE);
+    if (wav_path) {
+        machine->apu().set_sample_rate(SAMPLE_RATE);
+        if (!wav.open(wav_path)) {
+            std::fprintf(stderr, "cannot open %s\n", wav_path);
+            return 1;
+        }
+    }
+
+    // 扩展名为.y4m（或输出到管道）时写Y4M，其余写RGB24；--rgb强制RGB24
+    raw_video = raw_video || (video_path && std::strcmp(video_path, "-") != 0 && !ends_with(video_path, ".y4m"));
+    VideoWriter video(raw_video ? VideoWriter::RGB24 : VideoWriter::Y4M, frame_rate(bus.region()));
+    if (video_path) {
+        if (palette_path && !video.palette().load(palette_path)) {
+            std::fprintf(stderr, "cannot load palette: %s\n", palette_path);
+            return 1;
+        }
+        if (!video.open(video_path)) {
+            std::fprintf(stderr, "cannot open %s\n", video_path);
+            return 1;
+        }
+    }
+
+    std::vector<int16_t> samples(SAMPLE_RATE / 10);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; movie.apply(bus, frame); frame++) {
+        bus.run_frame();
+        if (video.is_open()) {
+            video.write_frame(machine->screen(), machine->emphasis());
+        }
+        if (wav.is_open()) {
+            size_t count = bus.read_samples(samples.data(), samples.size());
+            wav.write_samples(samples.data(), count);
+        }
+    }
+    double emulated = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // 等后台写完
+    uint64_t stalls = wav.stalls() + video.stalls();
+    bool ok = wav.close();
+    ok = video.close() && ok;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t frames = movie.frame_count();
+    std::fprintf(report, "frames:      %u\n", frames);
+    std::fprintf(report, "wall time:   %.3f s (%.1f frames/second, %.1fx real time)\n", seconds,
+                 seconds > 0.0 ? frames / seconds : 0.0,
+                 seconds > 0.0 ? frames / frame_rate(bus.region()) / seconds : 0.0);
+    std::fprintf(report, "emulation:   %.3f s, %llu writer stalls\n", emulated,
+                 static_cast<unsigned long long>(stalls));
+    if (wav_path) {
+        std::fprintf(report, "samples:     %llu at %u Hz\n",
+                     static_cast<unsigned long long>(wav.samples_written()), SAMPLE_RATE);
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "write error\n");
+        return 1;
+    }
+    return 0;
+}
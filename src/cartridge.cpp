@@ -1,28 +1,33 @@
 #include "cartridge.h"
-#include <fstream>
+#include <algorithm>
+#include <cstring>
 
 namespace cnes {
 
 Cartridge::Cartridge() : mirror_mode_(HORIZONTAL) {}
 
 bool Cartridge::load(const std::string &filename) {
-  std::ifstream file(filename, std::ios::binary);
-  if (!file)
+  // 文件只读映射，同一进程内多个卡带共享
+  std::shared_ptr<const RomImage> image = RomImage::open(filename);
+  if (!image)
     return false;
-  // 读取文件到内存
-  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
-                            std::istreambuf_iterator<char>());
-  return load_from_memory(data);
+  return load_image(std::move(image));
 }
 
 bool Cartridge::load_from_memory(std::vector<uint8_t> data) {
-  if (data.size() < sizeof(Header))
+  return load_image(RomImage::from_memory(std::move(data)));
+}
+
+bool Cartridge::load_image(std::shared_ptr<const RomImage> image) {
+  if (!image || image->size() < sizeof(Header))
     return false;
 
+  if (std::memcmp(image->data(), "NESM\x1A", 5) == 0)
+    return load_nsf(std::move(image));
+
   // 读取文件头
   Header header;
-  std::copy(data.begin(), data.begin() + sizeof(Header),
-            reinterpret_cast<uint8_t *>(&header));
+  std::memcpy(&header, image->data(), sizeof(Header));
 
   // 验证文件头
   if (header.name[0] != 'N' || header.name[1] != 'E' || header.name[2] != 'S' ||
@@ -32,70 +37,155 @@ bool Cartridge::load_from_memory(std::vector<uint8_t> data) {
   // 提取Mapper ID
   uint8_t mapper_id = ((header.flags7 & 0xF0) | (header.flags6 >> 4));
 
+  // PRG/CHR直接指向映像中的数据，跳过可能存在的512字节trainer
+  size_t offset = sizeof(Header) + ((header.flags6 & 0x04) ? 512 : 0);
+  size_t prg_rom_size = header.prg_rom_size * 16384;
+  size_t chr_rom_size = header.chr_rom_size * 8192;
+
+  RomSpan prg_rom = image->span(offset, prg_rom_size);
+  RomSpan chr_rom = image->span(offset + prg_rom_size, chr_rom_size);
+  if (prg_rom.empty() || (chr_rom_size > 0 && chr_rom.empty()))
+    return false; // 文件被截断
+
+  image_ = std::move(image);
+  prg_rom_ = prg_rom;
+  chr_rom_ = chr_rom;
+  mapper_id_ = mapper_id;
+  nsf_ = false;
+  nsf_prg_.reset();
+
   // 设置镜像模式
   mirror_mode_ = (header.flags6 & 0x01) ? VERTICAL : HORIZONTAL;
 
-  // 分配ROM/RAM空间
-  size_t prg_rom_size = header.prg_rom_size * 16384;
-  size_t chr_rom_size = header.chr_rom_size * 8192;
+  if (!create_mapper())
+    return false;
 
-  prg_rom_.resize(prg_rom_size);
-  chr_rom_.resize(chr_rom_size);
+  map_pages();
+  return true;
+}
+
+bool Cartridge::load_nsf(std::shared_ptr<const RomImage> image) {
+  if (image->size() <= sizeof(NsfHeader))
+    return false;
+
+  NsfHeader header;
+  std::memcpy(&header, image->data(), sizeof(NsfHeader));
+  size_t size = image->size() - sizeof(NsfHeader);
 
-  // 复制ROM数据
-  size_t offset = sizeof(Header);
-  std::copy(data.begin() + offset, data.begin() + offset + prg_rom_size,
-            prg_rom_.begin());
-  offset += prg_rom_size;
+  // 程序必须载入到$8000以上（$6000开始的FDS格式不支持）
+  if (header.song_count == 0 || header.load_address < 0x8000 || size == 0)
+    return false;
 
-  if (chr_rom_size > 0) {
-    std::copy(data.begin() + offset, data.begin() + offset + chr_rom_size,
-              chr_rom_.begin());
+  NsfInfo info;
+  info.song_count = header.song_count;
+  info.start_song = header.start_song > 0 && header.start_song <= header.song_count ? header.start_song - 1 : 0;
+  info.load_address = header.load_address;
+  info.init_address = header.init_address;
+  info.play_address = header.play_address;
+  info.region = (header.region & 0x03) == 0x01 ? Region::PAL : Region::NTSC;
+  info.play_speed = info.region == Region::PAL ? header.speed_pal : header.speed_ntsc;
+  info.expansion = header.expansion;
+  for (int i = 0; i < 8; i++) {
+    info.banks[i] = header.banks[i];
+    info.bankswitched = info.bankswitched || header.banks[i] != 0;
   }
+  info.title.assign(header.title, std::find(header.title, header.title + sizeof(header.title), '\0'));
+  info.artist.assign(header.artist, std::find(header.artist, header.artist + sizeof(header.artist), '\0'));
+  info.copyright.assign(header.copyright, std::find(header.copyright, header.copyright + sizeof(header.copyright), '\0'));
+
+  // 切换bank时数据从载入地址在4KB内的偏移开始；不切换时从$8000开始，截到32KB
+  size_t padding = info.bankswitched ? (header.load_address & 0x0FFF) : (header.load_address - 0x8000);
+  size_t total = info.bankswitched ? padding + size : 0x8000;
+  std::vector<uint8_t> prg((total + 0x1FFF) & ~static_cast<size_t>(0x1FFF), 0x00);
+  std::memcpy(prg.data() + padding, image->data() + sizeof(NsfHeader), std::min(size, prg.size() - padding));
+
+  image_ = std::move(image);
+  nsf_prg_ = RomImage::from_memory(std::move(prg));
+  prg_rom_ = nsf_prg_->span(0, nsf_prg_->size());
+  chr_rom_ = RomSpan();
+  mapper_id_ = 0;
+  nsf_ = true;
+  nsf_info_ = std::move(info);
+  mirror_mode_ = VERTICAL;
+
+  if (!create_mapper())
+    return false;
+
+  map_pages();
+  return true;
+}
 
-  // 创建对应的Mapper
-  switch (mapper_id) {
+bool Cartridge::create_mapper() {
+  if (nsf_) {
+    mapper_ = std::make_unique<MapperNsf>(prg_rom_, nsf_info_);
+    port_ = binder_(mapper_.get());
+    return true;
+  }
+
+  switch (mapper_id_) {
     case 0: // NROM
       mapper_ = std::make_unique<Mapper000>(prg_rom_, chr_rom_, mirror_mode_);
       break;
+    case 1: // MMC1
+      mapper_ = std::make_unique<Mapper001>(prg_rom_, chr_rom_, mirror_mode_);
+      break;
+    case 2: // UxROM
+      mapper_ = std::make_unique<Mapper002>(prg_rom_, chr_rom_, mirror_mode_);
+      break;
+    case 3: // CNROM
+      mapper_ = std::make_unique<Mapper003>(prg_rom_, chr_rom_, mirror_mode_);
+      break;
+    case 4: // MMC3
+      mapper_ = std::make_unique<Mapper004>(prg_rom_, chr_rom_, mirror_mode_);
+      break;
     default:
+      mapper_.reset();
+      port_ = MapperPort();
       return false; // 不支持的Mapper类型
   }
-
+  port_ = binder_(mapper_.get());
   return true;
 }
 
 void Cartridge::reset() {
-  if (mapper_)
-    mapper_.reset();
+  // 重新创建Mapper以恢复上电时的bank状态
+  if (image_)
+    create_mapper();
+  map_pages();
 }
 
-bool Cartridge::cpu_read(uint16_t addr, uint8_t &data) {
-  if (mapper_) {
-    return mapper_->cpu_read(addr, data);
-  }
-  return false;
+void Cartridge::connect_pages(PageTable* pages) {
+  cpu_pages_ = pages;
+  map_pages();
 }
 
-bool Cartridge::cpu_write(uint16_t addr, uint8_t data) {
-  if (mapper_) {
-    return mapper_->cpu_write(addr, data);
-  }
-  return false;
+void Cartridge::map_pages() {
+  if (!cpu_pages_)
+    return;
+
+  // 先交回给Mapper处理，再由Mapper映射可直接访问的bank
+  cpu_pages_->map_handler(0x6000, 0xA000, PageTable::CARTRIDGE);
+  if (mapper_)
+    mapper_->attach(cpu_pages_);
 }
 
-bool Cartridge::ppu_read(uint16_t addr, uint8_t &data) {
+Cartridge::MIRROR Cartridge::mirror() const {
   if (mapper_) {
-    return mapper_->ppu_read(addr, data);
+    return static_cast<MIRROR>(mapper_->mirror_mode());
   }
-  return false;
+  return mirror_mode_;
 }
 
-bool Cartridge::ppu_write(uint16_t addr, uint8_t data) {
-  if (mapper_) {
-    return mapper_->ppu_write(addr, data);
-  }
-  return false;
+int Cartridge::peek_mapper_id(const RomImage& image) {
+  if (image.size() < sizeof(Header))
+    return -1;
+
+  Header header;
+  std::memcpy(&header, image.data(), sizeof(Header));
+  if (header.name[0] != 'N' || header.name[1] != 'E' || header.name[2] != 'S' ||
+      header.name[3] != 0x1A)
+    return -1;
+  return (header.flags7 & 0xF0) | (header.flags6 >> 4);
 }
 
 } // namespace cnes
@@ -7,10 +7,16 @@
 #include <memory>
 #include "mapper.h"
 #include "mapper_000.h"
+#include "mapper_001.h"
+#include "mapper_002.h"
+#include "mapper_003.h"
+#include "mapper_004.h"
+#include "mapper_nsf.h"
+#include "rom_image.h"
 
 namespace cnes {
 
-// NES卡带
+// NES卡带（iNES文件，或由NSF文件构成的播放卡带）
 class Cartridge {
 public:
     Cartridge();
@@ -19,13 +25,33 @@ public:
     // 卡带操作
     bool load(const std::string& filename);    // 加载ROM文件
     bool load_from_memory(std::vector<uint8_t> data);      // 从内存中加载
+    bool load_image(std::shared_ptr<const RomImage> image); // 从共享的ROM映像加载
     void reset();                              // 重置卡带
 
-    // 内存访问
-    bool cpu_read(uint16_t addr, uint8_t& data);
-    bool cpu_write(uint16_t addr, uint8_t data);
-    bool ppu_read(uint16_t addr, uint8_t& data);
-    bool ppu_write(uint16_t addr, uint8_t data);
+    // 连接CPU页表，Mapper把PRG映射到$6000-$FFFF
+    void connect_pages(PageTable* pages);
+
+    // 内存访问（经由MapperPort，无卡带时返回false）
+    bool cpu_read(uint16_t addr, uint8_t& data) { return port_.cpu_read(port_.mapper, addr, data); }
+    bool cpu_write(uint16_t addr, uint8_t data) { return port_.cpu_write(port_.mapper, addr, data); }
+    bool ppu_read(uint16_t addr, uint8_t& data) { return port_.ppu_read(port_.mapper, addr, data); }
+    bool ppu_write(uint16_t addr, uint8_t data) { return port_.ppu_write(port_.mapper, addr, data); }
+
+    // 读取iNES文件头中的Mapper号，不是有效的iNES文件时返回-1
+    static int peek_mapper_id(const RomImage& image);
+    uint8_t mapper_id() const { return mapper_id_; }
+
+    // NSF文件的曲目信息，iNES文件时为nullptr
+    const NsfInfo* nsf() const { return nsf_ ? &nsf_info_ : nullptr; }
+    const std::shared_ptr<const RomImage>& image() const { return image_; }
+    Mapper* mapper() { return mapper_.get(); }
+
+    // 按具体Mapper类型绑定访问入口（由System<MapperT>调用，类型须与mapper_id()一致）
+    template <typename MapperT>
+    void specialize() {
+        binder_ = &MapperPort::bind<MapperT>;
+        port_ = binder_(mapper_.get());
+    }
 
     // 镜像模式
     enum MIRROR {
@@ -35,17 +61,47 @@ public:
         ONESCREEN_HI,
     };
 
-private:
-    // ROM数据
-    std::vector<uint8_t> prg_rom_;    // 程序ROM
-    std::vector<uint8_t> chr_rom_;    // 字符ROM
+    // 当前名称表镜像模式（由Mapper决定）
+    MIRROR mirror() const;
+
+    // CHR图块脏标记（见Mapper::take_dirty_tiles）
+    bool chr_dirty() const { return mapper_ && mapper_->chr_dirty(); }
+    void take_dirty_tiles(Mapper::TileMask& tiles) { mapper_->take_dirty_tiles(tiles); }
+
+    // 存档（Mapper寄存器、bank和RAM）
+    void serialize(StateStream& state) {
+        if (mapper_) {
+            mapper_->serialize(state);
+        }
+    }
 
-    // RAM数据
-    std::vector<uint8_t> prg_ram_;    // 程序RAM
-    std::vector<uint8_t> chr_ram_;    // 字符RAM
+    // 扫描线计数器与IRQ（见Mapper::scanlines_until_irq）
+    void scanline() {
+        if (mapper_) {
+            mapper_->scanline();
+        }
+    }
+    bool irq_state() const { return mapper_ && mapper_->irq_state(); }
+    int32_t scanlines_until_irq() const { return mapper_ ? mapper_->scanlines_until_irq() : -1; }
 
-    // Mapper
+private:
+    // ROM数据，指向共享映像，不复制
+    std::shared_ptr<const RomImage> image_;
+    RomSpan prg_rom_;    // 程序ROM
+    RomSpan chr_rom_;    // 字符ROM
+    uint8_t mapper_id_ = 0;
+
+    // Mapper（引用image_中的数据，必须在image_之后声明）
     std::unique_ptr<Mapper> mapper_;
+    bool create_mapper();
+
+    // Mapper访问入口，重新创建Mapper时用binder_重新绑定
+    MapperPort port_;
+    MapperPort (*binder_)(Mapper*) = &MapperPort::bind<Mapper>;
+
+    // CPU页表
+    PageTable* cpu_pages_ = nullptr;
+    void map_pages();
 
     // iNES文件头
     struct Header {
@@ -60,6 +116,33 @@ private:
         uint8_t padding[5];    // 未使用
     };
 
+    // NSF文件头（小端序）
+    struct NsfHeader {
+        char name[5];             // NESM^Z
+        uint8_t version;
+        uint8_t song_count;
+        uint8_t start_song;       // 从1开始
+        uint16_t load_address;
+        uint16_t init_address;
+        uint16_t play_address;
+        char title[32];
+        char artist[32];
+        char copyright[32];
+        uint16_t speed_ntsc;      // PLAY间隔（微秒）
+        uint8_t banks[8];         // 全为0时不切换bank
+        uint16_t speed_pal;
+        uint8_t region;           // 位0：PAL，位1：双制式
+        uint8_t expansion;        // 扩展音源
+        uint8_t padding[4];       // NSF2标志和数据长度
+    };
+    static_assert(sizeof(NsfHeader) == 0x80, "NSF header is 128 bytes");
+
+    // NSF：程序数据按载入地址补齐到4KB边界后放入nsf_prg_，由MapperNsf映射
+    bool nsf_ = false;
+    NsfInfo nsf_info_;
+    std::shared_ptr<const RomImage> nsf_prg_;
+    bool load_nsf(std::shared_ptr<const RomImage> image);
+
     // 镜像模式
     MIRROR mirror_mode_;
 };
@@ -1,12 +1,8 @@
 #include "cpu.h"
 #include "bus.h"
+#include "trace.h"
+#include "state.h"
 
-#include <ios>
-#include <iostream>
-#include <chrono>
-#include <ostream>
-#include <thread>
-#include <iomanip>
 
 namespace cnes {
 
@@ -24,28 +20,73 @@ namespace cnes {
     opcode_ = 0x00;
     cycles_ = 0;
     clock_count_ = 0;
-
-    enable_debugging();
   }
 
   void CPU::clock()
   {
     if (cycles_ == 0) {
-      // 获取新指令
-      opcode_ = read(pc_++);
-      // 执行指令
-      execute_instruction();
+      dispatch();
     }
 
     cycles_--;
     clock_count_++;
+  }
+
+  uint8_t CPU::step()
+  {
+    // 上一条指令（或复位）还有剩余周期时先把它们结算完
+    if (cycles_ == 0) {
+      dispatch();
+    }
+
+    uint8_t elapsed = cycles_;
+    cycles_ = 0;
+    clock_count_ += elapsed;
+    return elapsed;
+  }
 
-    if (enable_debugging_)
-    {
-      print_status();
+  void CPU::dispatch()
+  {
+    if (nmi_pending_) {
+      nmi_pending_ = false;
+      nmi();
+    }
+    else if (irq_lines_ && !(status_ & I)) {
+      irq();
+    }
+    else {
+      // 获取新指令
+      opcode_ = read(pc_++);
+
+      // 跟踪按需开启，关闭时只有这一次判断
+      if (trace_) {
+        record_trace();
+      }
+
+      // 执行指令
+      execute_instruction();
+      instruction_count_++;
     }
   }
 
+  void CPU::record_trace()
+  {
+    uint16_t pc = pc_ - 1;
+    TraceRecord record;
+    record.pc = pc;
+    record.opcode = opcode_;
+    record.operand[0] = bus_->peek(pc + 1);
+    record.operand[1] = bus_->peek(pc + 2);
+    record.a = a_;
+    record.x = x_;
+    record.y = y_;
+    record.p = status_;
+    record.sp = sp_;
+    record.cycle_hi = static_cast<uint16_t>(clock_count_ >> 32);
+    record.cycle_lo = static_cast<uint32_t>(clock_count_);
+    trace_->record(record);
+  }
+
   void CPU::reset()
   {
     // 初始化寄存器
@@ -53,16 +94,20 @@ namespace cnes {
     x_ = 0x00;
     y_ = 0x00;
     sp_ = 0xFD;
-    status_ = 0x00 | U;
+    status_ = 0x00 | U | I;    // 复位时屏蔽IRQ
 
     // 从复位向量获取程序计数器初始值
     uint16_t lo = read(RESET_VECTOR);
     uint16_t hi = read(RESET_VECTOR + 1);
     pc_ = (hi << 8) | lo;
 
-    // 重置内部状态
-    cycles_ = 8;
+    // 重置内部状态，复位序列占7个周期
+    cycles_ = 7;
     clock_count_ = 0;
+    nmi_pending_ = false;
+    irq_lines_ = 0x00;
+    instruction_count_ = 0;
+    jammed_ = false;
   }
 
   void CPU::irq()
@@ -113,6 +158,23 @@ namespace cnes {
     cycles_ = 8;
   }
 
+  void CPU::serialize(StateStream& state)
+  {
+    state(a_);
+    state(x_);
+    state(y_);
+    state(sp_);
+    state(pc_);
+    state(status_);
+    state(opcode_);
+    state(cycles_);
+    state(clock_count_);
+    state(nmi_pending_);
+    state(irq_lines_);
+    state(instruction_count_);
+    state(jammed_);
+  }
+
   void CPU::write(uint16_t addr, uint8_t data)
   {
     bus_->write(addr, data);
@@ -122,77 +184,4 @@ namespace cnes {
   {
     return bus_->read(addr);
   }
-
-  void CPU::print_status()
-  {
-    // 清除控制台
-    std::cout << "\033[2J\033[H";
-
-    std::cout << "================================" << std::endl;
-    std::cout << "MOS Technology 6502 CPU Debugger" << std::endl;
-    std::cout << "================================" << std::endl;
-
-    std::cout << "Clock:\t" << std::oct << clock_count_ << std::endl;
-    std::cout << "Cycle:\t" << std::oct << static_cast<int>(cycles_) << std::endl; 
-
-    std::cout << "A:\t0x" << std::hex << static_cast<int>(a_) << std::endl;
-    std::cout << "X:\t0x" << std::hex << static_cast<int>(x_) << std::endl;
-    std::cout << "Y:\t0x" << std::hex << static_cast<int>(y_) << std::endl;
-
-
-    std::cout << "Status:\t0x" << std::hex << static_cast<int>(status_) << " [";
-    std::cout << ((status_ & N) ? 'N' : '-') << " "
-              << ((status_ & V) ? 'V' : '-') << " "
-              << ((status_ & U) ? 'U' : '-') << " "
-              << ((status_ & B) ? 'B' : '-') << " "
-              << ((status_ & D) ? 'D' : '-') << " "
-              << ((status_ & I) ? 'I' : '-') << " "
-              << ((status_ & Z) ? 'Z' : '-') << " "
-              << ((status_ & C) ? 'C' : '-') << "]" << std::endl;
-
-    // 打印程序计数器（PC）
-    std::cout << "PC:\t0x" << std::hex << std::setfill('0') << std::setw(4) << pc_ << std::endl;
-
-    // 打印PC上下5个地址的内存内容
-    std::cout << "--------------------------------" << std::endl;
-    for (int i = 0; i <= 5; ++i) {
-        uint16_t addr = pc_ + i;
-
-        char p_char = ' ';
-        char e_char = ' ';
-
-        if (i == 0)
-        {
-          p_char = '[';
-          e_char = ']';
-        }
-
-        std::cout << p_char << "0x" << std::hex << std::setfill('0') << std::setw(4) << addr << ": "
-                  << "0x" << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(read(addr)) << e_char << std::endl;
-    }
-    std::cout << "--------------------------------" << std::endl;
-
-    std::cout << get_op_name() << std::endl;
-
-    std::cout << std::endl;
-    
-    std::cout << "SP:\t0x" << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(sp_) << std::endl;
-
-    std::cout << "Stack:" << std::endl;
-    for (uint16_t addr = STACK_BASE + sp_ + 1; addr <= STACK_BASE + sp_ + 5 && addr <= STACK_BASE + 0xFF; ++addr) {
-        std::cout << "0x" << std::hex << std::setfill('0') << std::setw(4) << addr << ": "
-                  << "0x" << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(read(addr)) << std::endl;
-    }
-
-    std::cout << std::endl;
-
-
-    std::chrono::milliseconds timespan(500);
-    std::this_thread::sleep_for(timespan);
-  }
-
-  void CPU::enable_debugging()
-  {
-    enable_debugging_ = true;
-  }
 }
@@ -7,6 +7,8 @@
 namespace cnes {
 
 class Bus;
+class TraceBuffer;
+class StateStream;
 
 // MOS Technology 6502 CPU
 class CPU {
@@ -30,7 +32,8 @@ public:
         ABY,    // 绝对Y变址
         IND,    // 间接寻址
         IZX,    // 间接X变址
-        IZY     // 间接Y变址
+        IZY,    // 间接Y变址
+        ACC     // 累加器寻址
     };
 
     // 状态标志位
@@ -48,17 +51,89 @@ public:
     CPU();
     ~CPU() = default;
 
-    // 指令操作函数
+    // 指令操作函数（官方指令）
+    void ADC(uint16_t addr);  // 带进位加法
+    void AND(uint16_t addr);  // 逻辑与
+    void ASL(uint16_t addr);  // 算术左移
+    void ASL_A(uint16_t addr); // 算术左移（累加器）
+    void BCC(uint16_t addr);  // 无进位时分支
+    void BCS(uint16_t addr);  // 进位时分支
+    void BEQ(uint16_t addr);  // 相等时分支
+    void BIT(uint16_t addr);  // 位测试
+    void BMI(uint16_t addr);  // 负数时分支
+    void BNE(uint16_t addr);  // 不相等时分支
+    void BPL(uint16_t addr);  // 正数时分支
+    void BRK(uint16_t addr);  // 软件中断
+    void BVC(uint16_t addr);  // 无溢出时分支
+    void BVS(uint16_t addr);  // 溢出时分支
+    void CLC(uint16_t addr);  // 清除进位标志
+    void CLD(uint16_t addr);  // 清除十进制标志
+    void CLI(uint16_t addr);  // 清除中断禁止标志
+    void CLV(uint16_t addr);  // 清除溢出标志
+    void CMP(uint16_t addr);  // 比较累加器
+    void CPX(uint16_t addr);  // 比较X寄存器
+    void CPY(uint16_t addr);  // 比较Y寄存器
+    void DEC(uint16_t addr);  // 内存减一
+    void DEX(uint16_t addr);  // X寄存器减一
+    void DEY(uint16_t addr);  // Y寄存器减一
+    void EOR(uint16_t addr);  // 逻辑异或
+    void INC(uint16_t addr);  // 内存加一
+    void INX(uint16_t addr);  // X寄存器加一
+    void INY(uint16_t addr);  // Y寄存器加一
+    void JMP(uint16_t addr);  // 跳转
+    void JSR(uint16_t addr);  // 跳转子程序
     void LDA(uint16_t addr);  // 加载累加器
     void LDX(uint16_t addr);  // 加载X寄存器
     void LDY(uint16_t addr);  // 加载Y寄存器
+    void LSR(uint16_t addr);  // 逻辑右移
+    void LSR_A(uint16_t addr); // 逻辑右移（累加器）
+    void NOP(uint16_t addr);  // 空操作
+    void ORA(uint16_t addr);  // 逻辑或
+    void PHA(uint16_t addr);  // 累加器入栈
+    void PHP(uint16_t addr);  // 状态寄存器入栈
+    void PLA(uint16_t addr);  // 累加器出栈
+    void PLP(uint16_t addr);  // 状态寄存器出栈
+    void ROL(uint16_t addr);  // 循环左移
+    void ROL_A(uint16_t addr); // 循环左移（累加器）
+    void ROR(uint16_t addr);  // 循环右移
+    void ROR_A(uint16_t addr); // 循环右移（累加器）
+    void RTI(uint16_t addr);  // 中断返回
+    void RTS(uint16_t addr);  // 子程序返回
+    void SBC(uint16_t addr);  // 带借位减法
+    void SEC(uint16_t addr);  // 设置进位标志
+    void SED(uint16_t addr);  // 设置十进制标志
+    void SEI(uint16_t addr);  // 设置中断禁止标志
     void STA(uint16_t addr);  // 存储累加器
     void STX(uint16_t addr);  // 存储X寄存器
     void STY(uint16_t addr);  // 存储Y寄存器
-    void BEQ(uint16_t addr);  // 相等时分支
-    void BNE(uint16_t addr);  // 不相等时分支
-    void BCS(uint16_t addr);  // 进位时分支
-    void BCC(uint16_t addr);  // 无进位时分支
+    void TAX(uint16_t addr);  // A传送到X
+    void TAY(uint16_t addr);  // A传送到Y
+    void TSX(uint16_t addr);  // SP传送到X
+    void TXA(uint16_t addr);  // X传送到A
+    void TXS(uint16_t addr);  // X传送到SP
+    void TYA(uint16_t addr);  // Y传送到A
+
+    // 指令操作函数（非官方指令）
+    void AHX(uint16_t addr);  // 存储 A & X & (H+1)
+    void ALR(uint16_t addr);  // AND + LSR
+    void ANC(uint16_t addr);  // AND，N复制到C
+    void ARR(uint16_t addr);  // AND + ROR
+    void AXS(uint16_t addr);  // X = (A & X) - 立即数
+    void DCP(uint16_t addr);  // DEC + CMP
+    void ISC(uint16_t addr);  // INC + SBC
+    void JAM(uint16_t addr);  // 锁死CPU
+    void LAS(uint16_t addr);  // A = X = SP = M & SP
+    void LAX(uint16_t addr);  // LDA + LDX
+    void LXA(uint16_t addr);  // 不稳定的立即数LAX
+    void RLA(uint16_t addr);  // ROL + AND
+    void RRA(uint16_t addr);  // ROR + ADC
+    void SAX(uint16_t addr);  // 存储 A & X
+    void SHX(uint16_t addr);  // 存储 X & (H+1)
+    void SHY(uint16_t addr);  // 存储 Y & (H+1)
+    void SLO(uint16_t addr);  // ASL + ORA
+    void SRE(uint16_t addr);  // LSR + EOR
+    void TAS(uint16_t addr);  // SP = A & X，存储 SP & (H+1)
+    void XAA(uint16_t addr);  // 不稳定的 TXA + AND
 
     // CPU与总线连接
     void connect_bus(Bus* bus) { bus_ = bus; }
@@ -66,11 +141,58 @@ public:
     // CPU操作
     void reset();    // 重置CPU
     void clock();    // 时钟周期
+    uint8_t step();  // 执行完整一条指令（或中断），返回消耗的周期数
     void irq();      // 可屏蔽中断
     void nmi();      // 不可屏蔽中断
 
+    // 把每条指令执行前的状态记录到环形缓冲区，传入nullptr关闭
+    void set_trace(TraceBuffer* trace) { trace_ = trace; }
+
+    // 操作码信息（反汇编用）
+    struct OpcodeInfo {
+        const char* name;
+        ADDR_MODE mode;
+        bool official;
+    };
+    static OpcodeInfo opcode_info(uint8_t opcode);
+
+    // 已执行的指令数
+    uint64_t instruction_count() const { return instruction_count_; }
+
+    // 请求在下一条指令前响应NMI
+    void request_nmi() { nmi_pending_ = true; }
+
+    // IRQ来源，电平触发：任一来源有效且I标志清除时在下一条指令前响应
+    enum IRQ_SOURCE : uint8_t {
+        IRQ_MAPPER = (1 << 0),
+        IRQ_APU    = (1 << 1),    // 帧计数器或DMC
+    };
+    void set_irq(IRQ_SOURCE source, bool asserted) {
+        irq_lines_ = asserted ? (irq_lines_ | source) : (irq_lines_ & ~source);
+    }
+
+    // 当前指令是否已执行完毕
+    bool complete() const { return cycles_ == 0; }
+
+    // CPU是否因JAM指令锁死
+    bool jammed() const { return jammed_; }
+
+    // 程序计数器和I标志（NSF播放时判断INIT/PLAY是否已返回）
+    uint16_t pc() const { return pc_; }
+    bool interrupts_disabled() const { return status_ & I; }
+
+    // 在指令边界处改为从addr开始执行，A、X为参数（NSF播放时调用INIT/PLAY）
+    void jump(uint16_t addr, uint8_t a, uint8_t x) {
+        pc_ = addr;
+        a_ = a;
+        x_ = x;
+    }
+
+    // 存档
+    void serialize(StateStream& state);
+
 private:
-    bool enable_debugging_ = false;
+    TraceBuffer* trace_ = nullptr;
 
     // CPU寄存器
     uint8_t a_ = 0x00;       // 累加器
@@ -83,12 +205,16 @@ private:
     // 内部变量
     uint8_t opcode_ = 0x00;           // 当前操作码
     uint8_t cycles_ = 0;              // 剩余周期数
-    uint32_t clock_count_ = 0;        // 时钟计数
+    uint64_t clock_count_ = 0;        // 时钟计数
+    bool nmi_pending_ = false;        // 待响应的NMI
+    uint8_t irq_lines_ = 0x00;        // 有效的IRQ来源
+    uint64_t instruction_count_ = 0;  // 指令计数
 
     // 总线指针
     Bus* bus_ = nullptr;
 
     // 指令执行
+    void dispatch();
     void execute_instruction();
     uint8_t fetch();
     bool get_operand_address(ADDR_MODE mode, uint16_t& addr);
@@ -97,18 +223,29 @@ private:
     void set_flag(FLAGS flag, bool value);
     bool get_flag(FLAGS flag);
 
-    // 分支指令状态
-    bool branch_taken_ = false;
+    // 指令辅助操作
+    void branch(bool condition, uint16_t offset);
+    void compare(uint8_t reg, uint8_t data);
+    void add_with_carry(uint8_t data);
+    void set_zn(uint8_t value);
+    void push(uint8_t data);
+    uint8_t pop();
+    uint8_t shift_left(uint8_t data);
+    uint8_t shift_right(uint8_t data);
+    uint8_t rotate_left(uint8_t data);
+    uint8_t rotate_right(uint8_t data);
+    void store_high_and(uint16_t addr, uint8_t data);
+
+    // 寻址状态
     bool page_crossed_ = false;
+    bool jammed_ = false;
 
     // 内存访问
     void write(uint16_t addr, uint8_t data);
     uint8_t read(uint16_t addr);
 
-    // 调试
-    void print_status();
-    void enable_debugging();
-    const char* get_op_name();
+    // 跟踪
+    void record_trace();
 };
 
 } // namespace cnes
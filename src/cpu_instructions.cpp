@@ -1,5 +1,7 @@
 #include "cpu.h"
 
+#include <array>
+
 namespace cnes {
 
 
@@ -18,6 +20,7 @@ bool CPU::get_operand_address(CPU::ADDR_MODE mode, uint16_t& addr)
     
     switch (mode) {
       case IMP:  // 隐含寻址
+      case ACC:  // 累加器寻址
         addr = 0;
         return false;
 
@@ -93,7 +96,202 @@ bool CPU::get_operand_address(CPU::ADDR_MODE mode, uint16_t& addr)
     }
   }
 
-  // 指令操作函数
+  // 辅助函数：设置零标志和负数标志
+  void CPU::set_zn(uint8_t value)
+  {
+    set_flag(Z, value == 0);
+    set_flag(N, value & 0x80);
+  }
+
+  // 辅助函数：入栈
+  void CPU::push(uint8_t data)
+  {
+    write(STACK_BASE + sp_, data);
+    sp_--;
+  }
+
+  // 辅助函数：出栈
+  uint8_t CPU::pop()
+  {
+    sp_++;
+    return read(STACK_BASE + sp_);
+  }
+
+  // 辅助函数：分支跳转，成功时加1周期，跨页再加1周期
+  void CPU::branch(bool condition, uint16_t offset)
+  {
+    if (condition) {
+      uint16_t old_pc = pc_;
+      pc_ += offset;
+      cycles_++;
+      if ((old_pc & 0xFF00) != (pc_ & 0xFF00)) {
+        cycles_++;
+      }
+    }
+  }
+
+  // 辅助函数：比较寄存器与内存
+  void CPU::compare(uint8_t reg, uint8_t data)
+  {
+    set_flag(C, reg >= data);
+    set_zn(static_cast<uint8_t>(reg - data));
+  }
+
+  // 辅助函数：带进位加法，SBC使用取反后的操作数
+  void CPU::add_with_carry(uint8_t data)
+  {
+    uint16_t sum = a_ + data + (get_flag(C) ? 1 : 0);
+    set_flag(C, sum > 0xFF);
+    set_flag(V, (~(a_ ^ data) & (a_ ^ sum)) & 0x80);
+    a_ = sum & 0xFF;
+    set_zn(a_);
+  }
+
+  // 辅助函数：移位操作
+  uint8_t CPU::shift_left(uint8_t data)
+  {
+    set_flag(C, data & 0x80);
+    data <<= 1;
+    set_zn(data);
+    return data;
+  }
+
+  uint8_t CPU::shift_right(uint8_t data)
+  {
+    set_flag(C, data & 0x01);
+    data >>= 1;
+    set_zn(data);
+    return data;
+  }
+
+  uint8_t CPU::rotate_left(uint8_t data)
+  {
+    uint8_t carry = get_flag(C) ? 0x01 : 0x00;
+    set_flag(C, data & 0x80);
+    data = (data << 1) | carry;
+    set_zn(data);
+    return data;
+  }
+
+  uint8_t CPU::rotate_right(uint8_t data)
+  {
+    uint8_t carry = get_flag(C) ? 0x80 : 0x00;
+    set_flag(C, data & 0x01);
+    data = (data >> 1) | carry;
+    set_zn(data);
+    return data;
+  }
+
+  // 辅助函数：SHX/SHY/AHX/TAS存储 data & (H+1)，跨页时高字节被结果替换
+  void CPU::store_high_and(uint16_t addr, uint8_t data)
+  {
+    uint8_t hi = static_cast<uint8_t>(addr >> 8);
+    if (!page_crossed_) {
+      hi++;
+    }
+    uint8_t value = data & hi;
+    if (page_crossed_) {
+      addr = (value << 8) | (addr & 0xFF);
+    }
+    write(addr, value);
+  }
+
+  // 指令操作函数（官方指令）
+  void CPU::ADC(uint16_t addr) { add_with_carry(read(addr)); }
+  void CPU::SBC(uint16_t addr) { add_with_carry(~read(addr)); }
+
+  void CPU::AND(uint16_t addr) { a_ &= read(addr); set_zn(a_); }
+  void CPU::EOR(uint16_t addr) { a_ ^= read(addr); set_zn(a_); }
+  void CPU::ORA(uint16_t addr) { a_ |= read(addr); set_zn(a_); }
+
+  void CPU::ASL(uint16_t addr) { write(addr, shift_left(read(addr))); }
+  void CPU::LSR(uint16_t addr) { write(addr, shift_right(read(addr))); }
+  void CPU::ROL(uint16_t addr) { write(addr, rotate_left(read(addr))); }
+  void CPU::ROR(uint16_t addr) { write(addr, rotate_right(read(addr))); }
+  void CPU::ASL_A(uint16_t) { a_ = shift_left(a_); }
+  void CPU::LSR_A(uint16_t) { a_ = shift_right(a_); }
+  void CPU::ROL_A(uint16_t) { a_ = rotate_left(a_); }
+  void CPU::ROR_A(uint16_t) { a_ = rotate_right(a_); }
+
+  void CPU::BCC(uint16_t addr) { branch(!get_flag(C), addr); }
+  void CPU::BCS(uint16_t addr) { branch(get_flag(C), addr); }
+  void CPU::BEQ(uint16_t addr) { branch(get_flag(Z), addr); }
+  void CPU::BNE(uint16_t addr) { branch(!get_flag(Z), addr); }
+  void CPU::BMI(uint16_t addr) { branch(get_flag(N), addr); }
+  void CPU::BPL(uint16_t addr) { branch(!get_flag(N), addr); }
+  void CPU::BVC(uint16_t addr) { branch(!get_flag(V), addr); }
+  void CPU::BVS(uint16_t addr) { branch(get_flag(V), addr); }
+
+  void CPU::BIT(uint16_t addr) { // 位测试
+    uint8_t data = read(addr);
+    set_flag(Z, (a_ & data) == 0);
+    set_flag(N, data & 0x80);
+    set_flag(V, data & 0x40);
+  }
+
+  void CPU::BRK(uint16_t) { // 软件中断
+    pc_++;
+    push((pc_ >> 8) & 0xFF);
+    push(pc_ & 0xFF);
+    push(status_ | B | U);
+    set_flag(I, true);
+
+    uint16_t lo = read(IRQ_VECTOR);
+    uint16_t hi = read(IRQ_VECTOR + 1);
+    pc_ = (hi << 8) | lo;
+  }
+
+  void CPU::CLC(uint16_t) { set_flag(C, false); }
+  void CPU::CLD(uint16_t) { set_flag(D, false); }
+  void CPU::CLI(uint16_t) { set_flag(I, false); }
+  void CPU::CLV(uint16_t) { set_flag(V, false); }
+  void CPU::SEC(uint16_t) { set_flag(C, true); }
+  void CPU::SED(uint16_t) { set_flag(D, true); }
+  void CPU::SEI(uint16_t) { set_flag(I, true); }
+
+  void CPU::CMP(uint16_t addr) { compare(a_, read(addr)); }
+  void CPU::CPX(uint16_t addr) { compare(x_, read(addr)); }
+  void CPU::CPY(uint16_t addr) { compare(y_, read(addr)); }
+
+  void CPU::DEC(uint16_t addr) { // 内存减一
+    uint8_t data = read(addr) - 1;
+    write(addr, data);
+    set_zn(data);
+  }
+
+  void CPU::INC(uint16_t addr) { // 内存加一
+    uint8_t data = read(addr) + 1;
+    write(addr, data);
+    set_zn(data);
+  }
+
+  void CPU::DEX(uint16_t) { x_--; set_zn(x_); }
+  void CPU::DEY(uint16_t) { y_--; set_zn(y_); }
+  void CPU::INX(uint16_t) { x_++; set_zn(x_); }
+  void CPU::INY(uint16_t) { y_++; set_zn(y_); }
+
+  void CPU::JMP(uint16_t addr) { pc_ = addr; }
+
+  void CPU::JSR(uint16_t addr) { // 跳转子程序，压入返回地址-1
+    uint16_t ret = pc_ - 1;
+    push((ret >> 8) & 0xFF);
+    push(ret & 0xFF);
+    pc_ = addr;
+  }
+
+  void CPU::RTS(uint16_t) { // 子程序返回
+    uint16_t lo = pop();
+    uint16_t hi = pop();
+    pc_ = ((hi << 8) | lo) + 1;
+  }
+
+  void CPU::RTI(uint16_t) { // 中断返回
+    status_ = (pop() & ~B) | U;
+    uint16_t lo = pop();
+    uint16_t hi = pop();
+    pc_ = (hi << 8) | lo;
+  }
+
   void CPU::LDA(uint16_t addr) { // 加载累加器
     uint8_t data = read(addr);
     a_ = data;
@@ -127,97 +325,410 @@ bool CPU::get_operand_address(CPU::ADDR_MODE mode, uint16_t& addr)
     write(addr, y_);
   }
 
-  // 指令信息结构体
-  struct Instruction {
-    const char*   name;        // 名称
-    uint8_t opcode;      // 操作码
-    CPU::ADDR_MODE mode;      // 寻址模式
-    uint8_t cycles;      // 基本周期数
-    void (CPU::*operation)(uint16_t);  // 指令操作函数
-  };
+  void CPU::NOP(uint16_t) { }
+
+  void CPU::PHA(uint16_t) { push(a_); }
+  void CPU::PHP(uint16_t) { push(status_ | B | U); }
+  void CPU::PLA(uint16_t) { a_ = pop(); set_zn(a_); }
+  void CPU::PLP(uint16_t) { status_ = (pop() & ~B) | U; }
+
+  void CPU::TAX(uint16_t) { x_ = a_; set_zn(x_); }
+  void CPU::TAY(uint16_t) { y_ = a_; set_zn(y_); }
+  void CPU::TSX(uint16_t) { x_ = sp_; set_zn(x_); }
+  void CPU::TXA(uint16_t) { a_ = x_; set_zn(a_); }
+  void CPU::TXS(uint16_t) { sp_ = x_; }
+  void CPU::TYA(uint16_t) { a_ = y_; set_zn(a_); }
+
+  // 指令操作函数（非官方指令）
+  void CPU::SLO(uint16_t addr) { // ASL + ORA
+    uint8_t data = shift_left(read(addr));
+    write(addr, data);
+    a_ |= data;
+    set_zn(a_);
+  }
 
-  // 指令操作函数
-  void CPU::BEQ(uint16_t addr) { // 相等时分支
-    if (get_flag(Z)) {
-      uint16_t old_pc = pc_;
-      pc_ += addr;
-      branch_taken_ = true;
-      page_crossed_ = (old_pc & 0xFF00) != (pc_ & 0xFF00);
-    }
+  void CPU::RLA(uint16_t addr) { // ROL + AND
+    uint8_t data = rotate_left(read(addr));
+    write(addr, data);
+    a_ &= data;
+    set_zn(a_);
   }
 
-  void CPU::BNE(uint16_t addr) { // 不相等时分支
-    if (!get_flag(Z)) {
-      uint16_t old_pc = pc_;
-      pc_ += addr;
-      branch_taken_ = true;
-      page_crossed_ = (old_pc & 0xFF00) != (pc_ & 0xFF00);
-    }
+  void CPU::SRE(uint16_t addr) { // LSR + EOR
+    uint8_t data = shift_right(read(addr));
+    write(addr, data);
+    a_ ^= data;
+    set_zn(a_);
   }
 
-  void CPU::BCS(uint16_t addr) { // 进位时分支
-    if (get_flag(C)) {
-      uint16_t old_pc = pc_;
-      pc_ += addr;
-      branch_taken_ = true;
-      page_crossed_ = (old_pc & 0xFF00) != (pc_ & 0xFF00);
-    }
+  void CPU::RRA(uint16_t addr) { // ROR + ADC
+    uint8_t data = rotate_right(read(addr));
+    write(addr, data);
+    add_with_carry(data);
   }
 
-  void CPU::BCC(uint16_t addr) { // 无进位时分支
-    if (!get_flag(C)) {
-      uint16_t old_pc = pc_;
-      pc_ += addr;
-      branch_taken_ = true;
-      page_crossed_ = (old_pc & 0xFF00) != (pc_ & 0xFF00);
-    }
+  void CPU::DCP(uint16_t addr) { // DEC + CMP
+    uint8_t data = read(addr) - 1;
+    write(addr, data);
+    compare(a_, data);
+  }
+
+  void CPU::ISC(uint16_t addr) { // INC + SBC
+    uint8_t data = read(addr) + 1;
+    write(addr, data);
+    add_with_carry(~data);
+  }
+
+  void CPU::SAX(uint16_t addr) { write(addr, a_ & x_); }
+
+  void CPU::LAX(uint16_t addr) { // LDA + LDX
+    a_ = x_ = read(addr);
+    set_zn(a_);
+  }
+
+  void CPU::LXA(uint16_t addr) { // 不稳定指令，取常见的0xEE魔数
+    a_ = x_ = (a_ | 0xEE) & read(addr);
+    set_zn(a_);
+  }
+
+  void CPU::XAA(uint16_t addr) { // 不稳定指令，取常见的0xEE魔数
+    a_ = (a_ | 0xEE) & x_ & read(addr);
+    set_zn(a_);
+  }
+
+  void CPU::ANC(uint16_t addr) { // AND，N复制到C
+    a_ &= read(addr);
+    set_zn(a_);
+    set_flag(C, a_ & 0x80);
   }
 
-  // 指令表
-  static const Instruction instructions[] = {
-    {"IMM", 0xA9, CPU::ADDR_MODE::IMM, 2, &CPU::LDA}, // LDA Immediate
-    {"ZP0", 0xA5, CPU::ADDR_MODE::ZP0, 3, &CPU::LDA}, // LDA Zero Page
-    {"ZPX", 0xB5, CPU::ADDR_MODE::ZPX, 4, &CPU::LDA}, // LDA Zero Page,X
-    {"ABS", 0xAD, CPU::ADDR_MODE::ABS, 4, &CPU::LDA}, // LDA Absolute
-    {"ABX", 0xBD, CPU::ADDR_MODE::ABX, 4, &CPU::LDA}, // LDA Absolute,X
-    {"ABY", 0xB9, CPU::ADDR_MODE::ABY, 4, &CPU::LDA}, // LDA Absolute,Y
-    {"IZX", 0xA1, CPU::ADDR_MODE::IZX, 6, &CPU::LDA}, // LDA (Indirect,X)
-    {"IZY", 0xB1, CPU::ADDR_MODE::IZY, 5, &CPU::LDA}, // LDA (Indirect),Y
-         
-    {"IMM", 0xA2, CPU::ADDR_MODE::IMM, 2, &CPU::LDX}, // LDX Immediate
-    {"ZP0", 0xA6, CPU::ADDR_MODE::ZP0, 3, &CPU::LDX}, // LDX Zero Page
-    {"ZPY", 0xB6, CPU::ADDR_MODE::ZPY, 4, &CPU::LDX}, // LDX Zero Page,Y
-    {"ABS", 0xAE, CPU::ADDR_MODE::ABS, 4, &CPU::LDX}, // LDX Absolute
-    {"ABY", 0xBE, CPU::ADDR_MODE::ABY, 4, &CPU::LDX}, // LDX Absolute,Y
-         
-    {"IMM", 0xA0, CPU::ADDR_MODE::IMM, 2, &CPU::LDY}, // LDY Immediate
-    {"ZP0", 0xA4, CPU::ADDR_MODE::ZP0, 3, &CPU::LDY}, // LDY Zero Page
-    {"ZPX", 0xB4, CPU::ADDR_MODE::ZPX, 4, &CPU::LDY}, // LDY Zero Page,X
-    {"ABS", 0xAC, CPU::ADDR_MODE::ABS, 4, &CPU::LDY}, // LDY Absolute
-    {"ABX", 0xBC, CPU::ADDR_MODE::ABX, 4, &CPU::LDY}, // LDY Absolute,X
-         
-    {"ZP0", 0x85, CPU::ADDR_MODE::ZP0, 3, &CPU::STA}, // STA Zero Page
-    {"ZPX", 0x95, CPU::ADDR_MODE::ZPX, 4, &CPU::STA}, // STA Zero Page,X
-    {"ABS", 0x8D, CPU::ADDR_MODE::ABS, 4, &CPU::STA}, // STA Absolute
-    {"ABX", 0x9D, CPU::ADDR_MODE::ABX, 5, &CPU::STA}, // STA Absolute,X
-    {"ABY", 0x99, CPU::ADDR_MODE::ABY, 5, &CPU::STA}, // STA Absolute,Y
-    {"IZX", 0x81, CPU::ADDR_MODE::IZX, 6, &CPU::STA}, // STA (Indirect,X)
-    {"IZY", 0x91, CPU::ADDR_MODE::IZY, 6, &CPU::STA}, // STA (Indirect),Y
-         
-    {"ZP0", 0x86, CPU::ADDR_MODE::ZP0, 3, &CPU::STX}, // STX Zero Page
-    {"ZPY", 0x96, CPU::ADDR_MODE::ZPY, 4, &CPU::STX}, // STX Zero Page,Y
-    {"ABS", 0x8E, CPU::ADDR_MODE::ABS, 4, &CPU::STX}, // STX Absolute
-         
-    {"ZP0", 0x84, CPU::ADDR_MODE::ZP0, 3, &CPU::STY}, // STY Zero Page
-    {"ZPX", 0x94, CPU::ADDR_MODE::ZPX, 4, &CPU::STY}, // STY Zero Page,X
-    {"ABS", 0x8C, CPU::ADDR_MODE::ABS, 4, &CPU::STY}, // STY Absolute
-         
-    {"REL", 0xF0, CPU::ADDR_MODE::REL, 2, &CPU::BEQ}, // BEQ
-    {"REL", 0xD0, CPU::ADDR_MODE::REL, 2, &CPU::BNE}, // BNE
-    {"REL", 0xB0, CPU::ADDR_MODE::REL, 2, &CPU::BCS}, // BCS
-    {"REL", 0x90, CPU::ADDR_MODE::REL, 2, &CPU::BCC}  // BCC
+  void CPU::ALR(uint16_t addr) { // AND + LSR
+    a_ = shift_right(a_ & read(addr));
+  }
+
+  void CPU::ARR(uint16_t addr) { // AND + ROR，C取bit6，V取bit6^bit5
+    a_ &= read(addr);
+    a_ = (a_ >> 1) | (get_flag(C) ? 0x80 : 0x00);
+    set_zn(a_);
+    set_flag(C, a_ & 0x40);
+    set_flag(V, ((a_ >> 6) ^ (a_ >> 5)) & 0x01);
+  }
+
+  void CPU::AXS(uint16_t addr) { // X = (A & X) - 立即数
+    uint8_t data = read(addr);
+    uint8_t value = a_ & x_;
+    set_flag(C, value >= data);
+    x_ = value - data;
+    set_zn(x_);
+  }
+
+  void CPU::LAS(uint16_t addr) { // A = X = SP = M & SP
+    a_ = x_ = sp_ = read(addr) & sp_;
+    set_zn(a_);
+  }
+
+  void CPU::AHX(uint16_t addr) { store_high_and(addr, a_ & x_); }
+  void CPU::SHX(uint16_t addr) { store_high_and(addr, x_); }
+  void CPU::SHY(uint16_t addr) { store_high_and(addr, y_); }
+
+  void CPU::TAS(uint16_t addr) { // SP = A & X
+    sp_ = a_ & x_;
+    store_high_and(addr, sp_);
+  }
+
+  void CPU::JAM(uint16_t) { // 锁死CPU，PC停在本指令上直到复位
+    pc_--;
+    jammed_ = true;
+  }
+
+  // 指令信息结构体
+  struct Instruction {
+    const char*   name;        // 名称
+    CPU::ADDR_MODE mode;      // 寻址模式
+    uint8_t cycles;      // 基本周期数
+    bool page_penalty;   // 跨页时是否增加1个周期
+    bool official;       // 是否为官方指令
+    void (CPU::*operation)(uint16_t);  // 指令操作函数
   };
 
+  // 指令表，按操作码直接索引
+  static constexpr Instruction instructions[256] = {
+    {"BRK", CPU::IMP, 7, false, true , &CPU::BRK},   // 0x00
+    {"ORA", CPU::IZX, 6, false, true , &CPU::ORA},   // 0x01
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x02
+    {"SLO", CPU::IZX, 8, false, false, &CPU::SLO},   // 0x03
+    {"NOP", CPU::ZP0, 3, false, false, &CPU::NOP},   // 0x04
+    {"ORA", CPU::ZP0, 3, false, true , &CPU::ORA},   // 0x05
+    {"ASL", CPU::ZP0, 5, false, true , &CPU::ASL},   // 0x06
+    {"SLO", CPU::ZP0, 5, false, false, &CPU::SLO},   // 0x07
+    {"PHP", CPU::IMP, 3, false, true , &CPU::PHP},   // 0x08
+    {"ORA", CPU::IMM, 2, false, true , &CPU::ORA},   // 0x09
+    {"ASL", CPU::ACC, 2, false, true , &CPU::ASL_A}, // 0x0A
+    {"ANC", CPU::IMM, 2, false, false, &CPU::ANC},   // 0x0B
+    {"NOP", CPU::ABS, 4, false, false, &CPU::NOP},   // 0x0C
+    {"ORA", CPU::ABS, 4, false, true , &CPU::ORA},   // 0x0D
+    {"ASL", CPU::ABS, 6, false, true , &CPU::ASL},   // 0x0E
+    {"SLO", CPU::ABS, 6, false, false, &CPU::SLO},   // 0x0F
+
+    {"BPL", CPU::REL, 2, false, true , &CPU::BPL},   // 0x10
+    {"ORA", CPU::IZY, 5, true , true , &CPU::ORA},   // 0x11
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x12
+    {"SLO", CPU::IZY, 8, false, false, &CPU::SLO},   // 0x13
+    {"NOP", CPU::ZPX, 4, false, false, &CPU::NOP},   // 0x14
+    {"ORA", CPU::ZPX, 4, false, true , &CPU::ORA},   // 0x15
+    {"ASL", CPU::ZPX, 6, false, true , &CPU::ASL},   // 0x16
+    {"SLO", CPU::ZPX, 6, false, false, &CPU::SLO},   // 0x17
+    {"CLC", CPU::IMP, 2, false, true , &CPU::CLC},   // 0x18
+    {"ORA", CPU::ABY, 4, true , true , &CPU::ORA},   // 0x19
+    {"NOP", CPU::IMP, 2, false, false, &CPU::NOP},   // 0x1A
+    {"SLO", CPU::ABY, 7, false, false, &CPU::SLO},   // 0x1B
+    {"NOP", CPU::ABX, 4, true , false, &CPU::NOP},   // 0x1C
+    {"ORA", CPU::ABX, 4, true , true , &CPU::ORA},   // 0x1D
+    {"ASL", CPU::ABX, 7, false, true , &CPU::ASL},   // 0x1E
+    {"SLO", CPU::ABX, 7, false, false, &CPU::SLO},   // 0x1F
+
+    {"JSR", CPU::ABS, 6, false, true , &CPU::JSR},   // 0x20
+    {"AND", CPU::IZX, 6, false, true , &CPU::AND},   // 0x21
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x22
+    {"RLA", CPU::IZX, 8, false, false, &CPU::RLA},   // 0x23
+    {"BIT", CPU::ZP0, 3, false, true , &CPU::BIT},   // 0x24
+    {"AND", CPU::ZP0, 3, false, true , &CPU::AND},   // 0x25
+    {"ROL", CPU::ZP0, 5, false, true , &CPU::ROL},   // 0x26
+    {"RLA", CPU::ZP0, 5, false, false, &CPU::RLA},   // 0x27
+    {"PLP", CPU::IMP, 4, false, true , &CPU::PLP},   // 0x28
+    {"AND", CPU::IMM, 2, false, true , &CPU::AND},   // 0x29
+    {"ROL", CPU::ACC, 2, false, true , &CPU::ROL_A}, // 0x2A
+    {"ANC", CPU::IMM, 2, false, false, &CPU::ANC},   // 0x2B
+    {"BIT", CPU::ABS, 4, false, true , &CPU::BIT},   // 0x2C
+    {"AND", CPU::ABS, 4, false, true , &CPU::AND},   // 0x2D
+    {"ROL", CPU::ABS, 6, false, true , &CPU::ROL},   // 0x2E
+    {"RLA", CPU::ABS, 6, false, false, &CPU::RLA},   // 0x2F
+
+    {"BMI", CPU::REL, 2, false, true , &CPU::BMI},   // 0x30
+    {"AND", CPU::IZY, 5, true , true , &CPU::AND},   // 0x31
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x32
+    {"RLA", CPU::IZY, 8, false, false, &CPU::RLA},   // 0x33
+    {"NOP", CPU::ZPX, 4, false, false, &CPU::NOP},   // 0x34
+    {"AND", CPU::ZPX, 4, false, true , &CPU::AND},   // 0x35
+    {"ROL", CPU::ZPX, 6, false, true , &CPU::ROL},   // 0x36
+    {"RLA", CPU::ZPX, 6, false, false, &CPU::RLA},   // 0x37
+    {"SEC", CPU::IMP, 2, false, true , &CPU::SEC},   // 0x38
+    {"AND", CPU::ABY, 4, true , true , &CPU::AND},   // 0x39
+    {"NOP", CPU::IMP, 2, false, false, &CPU::NOP},   // 0x3A
+    {"RLA", CPU::ABY, 7, false, false, &CPU::RLA},   // 0x3B
+    {"NOP", CPU::ABX, 4, true , false, &CPU::NOP},   // 0x3C
+    {"AND", CPU::ABX, 4, true , true , &CPU::AND},   // 0x3D
+    {"ROL", CPU::ABX, 7, false, true , &CPU::ROL},   // 0x3E
+    {"RLA", CPU::ABX, 7, false, false, &CPU::RLA},   // 0x3F
+
+    {"RTI", CPU::IMP, 6, false, true , &CPU::RTI},   // 0x40
+    {"EOR", CPU::IZX, 6, false, true , &CPU::EOR},   // 0x41
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x42
+    {"SRE", CPU::IZX, 8, false, false, &CPU::SRE},   // 0x43
+    {"NOP", CPU::ZP0, 3, false, false, &CPU::NOP},   // 0x44
+    {"EOR", CPU::ZP0, 3, false, true , &CPU::EOR},   // 0x45
+    {"LSR", CPU::ZP0, 5, false, true , &CPU::LSR},   // 0x46
+    {"SRE", CPU::ZP0, 5, false, false, &CPU::SRE},   // 0x47
+    {"PHA", CPU::IMP, 3, false, true , &CPU::PHA},   // 0x48
+    {"EOR", CPU::IMM, 2, false, true , &CPU::EOR},   // 0x49
+    {"LSR", CPU::ACC, 2, false, true , &CPU::LSR_A}, // 0x4A
+    {"ALR", CPU::IMM, 2, false, false, &CPU::ALR},   // 0x4B
+    {"JMP", CPU::ABS, 3, false, true , &CPU::JMP},   // 0x4C
+    {"EOR", CPU::ABS, 4, false, true , &CPU::EOR},   // 0x4D
+    {"LSR", CPU::ABS, 6, false, true , &CPU::LSR},   // 0x4E
+    {"SRE", CPU::ABS, 6, false, false, &CPU::SRE},   // 0x4F
+
+    {"BVC", CPU::REL, 2, false, true , &CPU::BVC},   // 0x50
+    {"EOR", CPU::IZY, 5, true , true , &CPU::EOR},   // 0x51
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x52
+    {"SRE", CPU::IZY, 8, false, false, &CPU::SRE},   // 0x53
+    {"NOP", CPU::ZPX, 4, false, false, &CPU::NOP},   // 0x54
+    {"EOR", CPU::ZPX, 4, false, true , &CPU::EOR},   // 0x55
+    {"LSR", CPU::ZPX, 6, false, true , &CPU::LSR},   // 0x56
+    {"SRE", CPU::ZPX, 6, false, false, &CPU::SRE},   // 0x57
+    {"CLI", CPU::IMP, 2, false, true , &CPU::CLI},   // 0x58
+    {"EOR", CPU::ABY, 4, true , true , &CPU::EOR},   // 0x59
+    {"NOP", CPU::IMP, 2, false, false, &CPU::NOP},   // 0x5A
+    {"SRE", CPU::ABY, 7, false, false, &CPU::SRE},   // 0x5B
+    {"NOP", CPU::ABX, 4, true , false, &CPU::NOP},   // 0x5C
+    {"EOR", CPU::ABX, 4, true , true , &CPU::EOR},   // 0x5D
+    {"LSR", CPU::ABX, 7, false, true , &CPU::LSR},   // 0x5E
+    {"SRE", CPU::ABX, 7, false, false, &CPU::SRE},   // 0x5F
+
+    {"RTS", CPU::IMP, 6, false, true , &CPU::RTS},   // 0x60
+    {"ADC", CPU::IZX, 6, false, true , &CPU::ADC},   // 0x61
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x62
+    {"RRA", CPU::IZX, 8, false, false, &CPU::RRA},   // 0x63
+    {"NOP", CPU::ZP0, 3, false, false, &CPU::NOP},   // 0x64
+    {"ADC", CPU::ZP0, 3, false, true , &CPU::ADC},   // 0x65
+    {"ROR", CPU::ZP0, 5, false, true , &CPU::ROR},   // 0x66
+    {"RRA", CPU::ZP0, 5, false, false, &CPU::RRA},   // 0x67
+    {"PLA", CPU::IMP, 4, false, true , &CPU::PLA},   // 0x68
+    {"ADC", CPU::IMM, 2, false, true , &CPU::ADC},   // 0x69
+    {"ROR", CPU::ACC, 2, false, true , &CPU::ROR_A}, // 0x6A
+    {"ARR", CPU::IMM, 2, false, false, &CPU::ARR},   // 0x6B
+    {"JMP", CPU::IND, 5, false, true , &CPU::JMP},   // 0x6C
+    {"ADC", CPU::ABS, 4, false, true , &CPU::ADC},   // 0x6D
+    {"ROR", CPU::ABS, 6, false, true , &CPU::ROR},   // 0x6E
+    {"RRA", CPU::ABS, 6, false, false, &CPU::RRA},   // 0x6F
+
+    {"BVS", CPU::REL, 2, false, true , &CPU::BVS},   // 0x70
+    {"ADC", CPU::IZY, 5, true , true , &CPU::ADC},   // 0x71
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x72
+    {"RRA", CPU::IZY, 8, false, false, &CPU::RRA},   // 0x73
+    {"NOP", CPU::ZPX, 4, false, false, &CPU::NOP},   // 0x74
+    {"ADC", CPU::ZPX, 4, false, true , &CPU::ADC},   // 0x75
+    {"ROR", CPU::ZPX, 6, false, true , &CPU::ROR},   // 0x76
+    {"RRA", CPU::ZPX, 6, false, false, &CPU::RRA},   // 0x77
+    {"SEI", CPU::IMP, 2, false, true , &CPU::SEI},   // 0x78
+    {"ADC", CPU::ABY, 4, true , true , &CPU::ADC},   // 0x79
+    {"NOP", CPU::IMP, 2, false, false, &CPU::NOP},   // 0x7A
+    {"RRA", CPU::ABY, 7, false, false, &CPU::RRA},   // 0x7B
+    {"NOP", CPU::ABX, 4, true , false, &CPU::NOP},   // 0x7C
+    {"ADC", CPU::ABX, 4, true , true , &CPU::ADC},   // 0x7D
+    {"ROR", CPU::ABX, 7, false, true , &CPU::ROR},   // 0x7E
+    {"RRA", CPU::ABX, 7, false, false, &CPU::RRA},   // 0x7F
+
+    {"NOP", CPU::IMM, 2, false, false, &CPU::NOP},   // 0x80
+    {"STA", CPU::IZX, 6, false, true , &CPU::STA},   // 0x81
+    {"NOP", CPU::IMM, 2, false, false, &CPU::NOP},   // 0x82
+    {"SAX", CPU::IZX, 6, false, false, &CPU::SAX},   // 0x83
+    {"STY", CPU::ZP0, 3, false, true , &CPU::STY},   // 0x84
+    {"STA", CPU::ZP0, 3, false, true , &CPU::STA},   // 0x85
+    {"STX", CPU::ZP0, 3, false, true , &CPU::STX},   // 0x86
+    {"SAX", CPU::ZP0, 3, false, false, &CPU::SAX},   // 0x87
+    {"DEY", CPU::IMP, 2, false, true , &CPU::DEY},   // 0x88
+    {"NOP", CPU::IMM, 2, false, false, &CPU::NOP},   // 0x89
+    {"TXA", CPU::IMP, 2, false, true , &CPU::TXA},   // 0x8A
+    {"XAA", CPU::IMM, 2, false, false, &CPU::XAA},   // 0x8B
+    {"STY", CPU::ABS, 4, false, true , &CPU::STY},   // 0x8C
+    {"STA", CPU::ABS, 4, false, true , &CPU::STA},   // 0x8D
+    {"STX", CPU::ABS, 4, false, true , &CPU::STX},   // 0x8E
+    {"SAX", CPU::ABS, 4, false, false, &CPU::SAX},   // 0x8F
+
+    {"BCC", CPU::REL, 2, false, true , &CPU::BCC},   // 0x90
+    {"STA", CPU::IZY, 6, false, true , &CPU::STA},   // 0x91
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0x92
+    {"AHX", CPU::IZY, 6, false, false, &CPU::AHX},   // 0x93
+    {"STY", CPU::ZPX, 4, false, true , &CPU::STY},   // 0x94
+    {"STA", CPU::ZPX, 4, false, true , &CPU::STA},   // 0x95
+    {"STX", CPU::ZPY, 4, false, true , &CPU::STX},   // 0x96
+    {"SAX", CPU::ZPY, 4, false, false, &CPU::SAX},   // 0x97
+    {"TYA", CPU::IMP, 2, false, true , &CPU::TYA},   // 0x98
+    {"STA", CPU::ABY, 5, false, true , &CPU::STA},   // 0x99
+    {"TXS", CPU::IMP, 2, false, true , &CPU::TXS},   // 0x9A
+    {"TAS", CPU::ABY, 5, false, false, &CPU::TAS},   // 0x9B
+    {"SHY", CPU::ABX, 5, false, false, &CPU::SHY},   // 0x9C
+    {"STA", CPU::ABX, 5, false, true , &CPU::STA},   // 0x9D
+    {"SHX", CPU::ABY, 5, false, false, &CPU::SHX},   // 0x9E
+    {"AHX", CPU::ABY, 5, false, false, &CPU::AHX},   // 0x9F
+
+    {"LDY", CPU::IMM, 2, false, true , &CPU::LDY},   // 0xA0
+    {"LDA", CPU::IZX, 6, false, true , &CPU::LDA},   // 0xA1
+    {"LDX", CPU::IMM, 2, false, true , &CPU::LDX},   // 0xA2
+    {"LAX", CPU::IZX, 6, false, false, &CPU::LAX},   // 0xA3
+    {"LDY", CPU::ZP0, 3, false, true , &CPU::LDY},   // 0xA4
+    {"LDA", CPU::ZP0, 3, false, true , &CPU::LDA},   // 0xA5
+    {"LDX", CPU::ZP0, 3, false, true , &CPU::LDX},   // 0xA6
+    {"LAX", CPU::ZP0, 3, false, false, &CPU::LAX},   // 0xA7
+    {"TAY", CPU::IMP, 2, false, true , &CPU::TAY},   // 0xA8
+    {"LDA", CPU::IMM, 2, false, true , &CPU::LDA},   // 0xA9
+    {"TAX", CPU::IMP, 2, false, true , &CPU::TAX},   // 0xAA
+    {"LXA", CPU::IMM, 2, false, false, &CPU::LXA},   // 0xAB
+    {"LDY", CPU::ABS, 4, false, true , &CPU::LDY},   // 0xAC
+    {"LDA", CPU::ABS, 4, false, true , &CPU::LDA},   // 0xAD
+    {"LDX", CPU::ABS, 4, false, true , &CPU::LDX},   // 0xAE
+    {"LAX", CPU::ABS, 4, false, false, &CPU::LAX},   // 0xAF
+
+    {"BCS", CPU::REL, 2, false, true , &CPU::BCS},   // 0xB0
+    {"LDA", CPU::IZY, 5, true , true , &CPU::LDA},   // 0xB1
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0xB2
+    {"LAX", CPU::IZY, 5, true , false, &CPU::LAX},   // 0xB3
+    {"LDY", CPU::ZPX, 4, false, true , &CPU::LDY},   // 0xB4
+    {"LDA", CPU::ZPX, 4, false, true , &CPU::LDA},   // 0xB5
+    {"LDX", CPU::ZPY, 4, false, true , &CPU::LDX},   // 0xB6
+    {"LAX", CPU::ZPY, 4, false, false, &CPU::LAX},   // 0xB7
+    {"CLV", CPU::IMP, 2, false, true , &CPU::CLV},   // 0xB8
+    {"LDA", CPU::ABY, 4, true , true , &CPU::LDA},   // 0xB9
+    {"TSX", CPU::IMP, 2, false, true , &CPU::TSX},   // 0xBA
+    {"LAS", CPU::ABY, 4, true , false, &CPU::LAS},   // 0xBB
+    {"LDY", CPU::ABX, 4, true , true , &CPU::LDY},   // 0xBC
+    {"LDA", CPU::ABX, 4, true , true , &CPU::LDA},   // 0xBD
+    {"LDX", CPU::ABY, 4, true , true , &CPU::LDX},   // 0xBE
+    {"LAX", CPU::ABY, 4, true , false, &CPU::LAX},   // 0xBF
+
+    {"CPY", CPU::IMM, 2, false, true , &CPU::CPY},   // 0xC0
+    {"CMP", CPU::IZX, 6, false, true , &CPU::CMP},   // 0xC1
+    {"NOP", CPU::IMM, 2, false, false, &CPU::NOP},   // 0xC2
+    {"DCP", CPU::IZX, 8, false, false, &CPU::DCP},   // 0xC3
+    {"CPY", CPU::ZP0, 3, false, true , &CPU::CPY},   // 0xC4
+    {"CMP", CPU::ZP0, 3, false, true , &CPU::CMP},   // 0xC5
+    {"DEC", CPU::ZP0, 5, false, true , &CPU::DEC},   // 0xC6
+    {"DCP", CPU::ZP0, 5, false, false, &CPU::DCP},   // 0xC7
+    {"INY", CPU::IMP, 2, false, true , &CPU::INY},   // 0xC8
+    {"CMP", CPU::IMM, 2, false, true , &CPU::CMP},   // 0xC9
+    {"DEX", CPU::IMP, 2, false, true , &CPU::DEX},   // 0xCA
+    {"AXS", CPU::IMM, 2, false, false, &CPU::AXS},   // 0xCB
+    {"CPY", CPU::ABS, 4, false, true , &CPU::CPY},   // 0xCC
+    {"CMP", CPU::ABS, 4, false, true , &CPU::CMP},   // 0xCD
+    {"DEC", CPU::ABS, 6, false, true , &CPU::DEC},   // 0xCE
+    {"DCP", CPU::ABS, 6, false, false, &CPU::DCP},   // 0xCF
+
+    {"BNE", CPU::REL, 2, false, true , &CPU::BNE},   // 0xD0
+    {"CMP", CPU::IZY, 5, true , true , &CPU::CMP},   // 0xD1
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0xD2
+    {"DCP", CPU::IZY, 8, false, false, &CPU::DCP},   // 0xD3
+    {"NOP", CPU::ZPX, 4, false, false, &CPU::NOP},   // 0xD4
+    {"CMP", CPU::ZPX, 4, false, true , &CPU::CMP},   // 0xD5
+    {"DEC", CPU::ZPX, 6, false, true , &CPU::DEC},   // 0xD6
+    {"DCP", CPU::ZPX, 6, false, false, &CPU::DCP},   // 0xD7
+    {"CLD", CPU::IMP, 2, false, true , &CPU::CLD},   // 0xD8
+    {"CMP", CPU::ABY, 4, true , true , &CPU::CMP},   // 0xD9
+    {"NOP", CPU::IMP, 2, false, false, &CPU::NOP},   // 0xDA
+    {"DCP", CPU::ABY, 7, false, false, &CPU::DCP},   // 0xDB
+    {"NOP", CPU::ABX, 4, true , false, &CPU::NOP},   // 0xDC
+    {"CMP", CPU::ABX, 4, true , true , &CPU::CMP},   // 0xDD
+    {"DEC", CPU::ABX, 7, false, true , &CPU::DEC},   // 0xDE
+    {"DCP", CPU::ABX, 7, false, false, &CPU::DCP},   // 0xDF
+
+    {"CPX", CPU::IMM, 2, false, true , &CPU::CPX},   // 0xE0
+    {"SBC", CPU::IZX, 6, false, true , &CPU::SBC},   // 0xE1
+    {"NOP", CPU::IMM, 2, false, false, &CPU::NOP},   // 0xE2
+    {"ISC", CPU::IZX, 8, false, false, &CPU::ISC},   // 0xE3
+    {"CPX", CPU::ZP0, 3, false, true , &CPU::CPX},   // 0xE4
+    {"SBC", CPU::ZP0, 3, false, true , &CPU::SBC},   // 0xE5
+    {"INC", CPU::ZP0, 5, false, true , &CPU::INC},   // 0xE6
+    {"ISC", CPU::ZP0, 5, false, false, &CPU::ISC},   // 0xE7
+    {"INX", CPU::IMP, 2, false, true , &CPU::INX},   // 0xE8
+    {"SBC", CPU::IMM, 2, false, true , &CPU::SBC},   // 0xE9
+    {"NOP", CPU::IMP, 2, false, true , &CPU::NOP},   // 0xEA
+    {"SBC", CPU::IMM, 2, false, false, &CPU::SBC},   // 0xEB
+    {"CPX", CPU::ABS, 4, false, true , &CPU::CPX},   // 0xEC
+    {"SBC", CPU::ABS, 4, false, true , &CPU::SBC},   // 0xED
+    {"INC", CPU::ABS, 6, false, true , &CPU::INC},   // 0xEE
+    {"ISC", CPU::ABS, 6, false, false, &CPU::ISC},   // 0xEF
+
+    {"BEQ", CPU::REL, 2, false, true , &CPU::BEQ},   // 0xF0
+    {"SBC", CPU::IZY, 5, true , true , &CPU::SBC},   // 0xF1
+    {"JAM", CPU::IMP, 2, false, false, &CPU::JAM},   // 0xF2
+    {"ISC", CPU::IZY, 8, false, false, &CPU::ISC},   // 0xF3
+    {"NOP", CPU::ZPX, 4, false, false, &CPU::NOP},   // 0xF4
+    {"SBC", CPU::ZPX, 4, false, true , &CPU::SBC},   // 0xF5
+    {"INC", CPU::ZPX, 6, false, true , &CPU::INC},   // 0xF6
+    {"ISC", CPU::ZPX, 6, false, false, &CPU::ISC},   // 0xF7
+    {"SED", CPU::IMP, 2, false, true , &CPU::SED},   // 0xF8
+    {"SBC", CPU::ABY, 4, true , true , &CPU::SBC},   // 0xF9
+    {"NOP", CPU::IMP, 2, false, false, &CPU::NOP},   // 0xFA
+    {"ISC", CPU::ABY, 7, false, false, &CPU::ISC},   // 0xFB
+    {"NOP", CPU::ABX, 4, true , false, &CPU::NOP},   // 0xFC
+    {"SBC", CPU::ABX, 4, true , true , &CPU::SBC},   // 0xFD
+    {"INC", CPU::ABX, 7, false, true , &CPU::INC},   // 0xFE
+    {"ISC", CPU::ABX, 7, false, false, &CPU::ISC},   // 0xFF
+  };
+
+  static_assert(sizeof(instructions) / sizeof(instructions[0]) == 256,
+                "instruction table must cover every opcode");
+
   // 辅助函数：设置状态寄存器标志位
   void CPU::set_flag(FLAGS flag, bool value)
   {
@@ -235,50 +746,25 @@ bool CPU::get_operand_address(CPU::ADDR_MODE mode, uint16_t& addr)
 
   void CPU::execute_instruction()
   {
-    // 根据操作码查找指令
-    for (const auto& inst : instructions) {
-      if (inst.opcode == opcode_) {
-        uint16_t addr;
-        bool page_crossed = get_operand_address(inst.mode, addr);
-        bool branch_taken = false;
-        
-        // 执行指令
-        (this->*inst.operation)(addr);
-        
-        // 设置基本周期数
-        cycles_ = inst.cycles;
-        
-        // 处理分支指令的额外周期
-        if (inst.mode == REL) {
-          // 分支成功时增加1个周期
-          if (branch_taken) {
-            cycles_++;
-            // 跨页时再增加1个周期
-            if (page_crossed) {
-              cycles_++;
-            }
-          }
-        }
-        // 其他指令的跨页处理
-        else if (page_crossed) {
-          cycles_++;
-        }
-        
-        return;
-      }
+    const Instruction& inst = instructions[opcode_];
+
+    uint16_t addr;
+    page_crossed_ = get_operand_address(inst.mode, addr);
+
+    // 设置基本周期数，读类指令跨页时增加1个周期
+    cycles_ = inst.cycles;
+    if (page_crossed_ && inst.page_penalty) {
+      cycles_++;
     }
 
-    // 未知指令
-    cycles_ = 1;
+    // 执行指令（分支指令自行累加额外周期）
+    (this->*inst.operation)(addr);
   }
 
 
-  const char* CPU::get_op_name()
+  CPU::OpcodeInfo CPU::opcode_info(uint8_t opcode)
   {
-    if (opcode_ == 0x00)
-    {
-      return "None";
-    }
-    return instructions[opcode_].name;
+    const Instruction& inst = instructions[opcode];
+    return {inst.name, inst.mode, inst.official};
   }
 }
@@ -49,7 +49,7 @@ bool Display::init(const char* title, int width, int height, int scale) {
     // 创建纹理
     texture_ = SDL_CreateTexture(
         renderer_,
-        SDL_PIXELFORMAT_RGB24,
+        SDL_PIXELFORMAT_ARGB8888,
         SDL_TEXTUREACCESS_STREAMING,
         width,
         height
@@ -68,12 +68,9 @@ bool Display::init(const char* title, int width, int height, int scale) {
     return true;
 }
 
-void Display::update_screen(uint8_t* screen_data) {
-    // 将PPU的输出数据转换为RGB格式
-    for (int i = 0; i < width_ * height_; i++) {
-        // 这里简单地将PPU的输出转换为灰度值
-        pixels_[i] = screen_data[i] | (screen_data[i] << 8) | (screen_data[i] << 16);
-    }
+void Display::update_screen(const uint8_t* screen_data, const uint8_t* emphasis) {
+    // 将PPU输出的颜色索引查调色板转换为ARGB
+    palette_.convert(screen_data, emphasis, pixels_);
 
     // 更新纹理
     SDL_UpdateTexture(texture_, NULL, pixels_, width_ * sizeof(uint32_t));
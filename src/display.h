@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <SDL2/SDL.h>
+#include "palette.h"
 
 namespace cnes {
 
@@ -19,8 +20,11 @@ public:
     // 连接PPU
     void connect_ppu(PPU* ppu) { ppu_ = ppu; }
 
-    // 更新和渲染画面
-    void update_screen(uint8_t* screen_data);
+    // 调色板（可替换为.pal文件中的颜色）
+    Palette& palette() { return palette_; }
+
+    // 更新和渲染画面：screen_data为6位颜色索引，emphasis为每条扫描线的强调位
+    void update_screen(const uint8_t* screen_data, const uint8_t* emphasis = nullptr);
 
     // 处理事件
     bool handle_events();
@@ -33,6 +37,7 @@ private:
     SDL_Renderer* renderer_;
     SDL_Texture* texture_;
     uint32_t* pixels_;
+    Palette palette_;
     int width_;
     int height_;
     
@@ -0,0 +1,81 @@
+#include "input_script.h"
+#include "bus.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace cnes {
+
+bool InputScript::parse_buttons(const std::string& text, uint8_t& buttons) {
+    buttons = 0;
+    if (text == "-") {
+        return true;
+    }
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        buttons = static_cast<uint8_t>(std::strtoul(text.c_str() + 2, nullptr, 16));
+        return true;
+    }
+
+    static const struct { const char* name; uint8_t mask; } names[] = {
+        {"A", BUTTON_A}, {"B", BUTTON_B}, {"SELECT", BUTTON_SELECT}, {"START", BUTTON_START},
+        {"UP", BUTTON_UP}, {"DOWN", BUTTON_DOWN}, {"LEFT", BUTTON_LEFT}, {"RIGHT", BUTTON_RIGHT},
+    };
+
+    std::stringstream ss(text);
+    std::string token;
+    while (std::getline(ss, token, '+')) {
+        bool found = false;
+        for (const auto& name : names) {
+            if (token == name.name) {
+                buttons |= name.mask;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InputScript::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        return false;
+    }
+
+    events_.clear();
+    next_ = 0;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string frame, pad1, pad2 = "-";
+        if (!(ss >> frame) || frame[0] == '#') {
+            continue;
+        }
+        if (!(ss >> pad1)) {
+            return false;
+        }
+        ss >> pad2;
+
+        Event event{};
+        event.frame = static_cast<uint32_t>(std::strtoul(frame.c_str(), nullptr, 10));
+        if (!parse_buttons(pad1, event.buttons[0]) || !parse_buttons(pad2, event.buttons[1])) {
+            return false;
+        }
+        events_.push_back(event);
+    }
+    return true;
+}
+
+void InputScript::apply(Bus& bus, uint32_t frame) {
+    while (next_ < events_.size() && events_[next_].frame <= frame) {
+        bus.set_controller(0, events_[next_].buttons[0]);
+        bus.set_controller(1, events_[next_].buttons[1]);
+        next_++;
+    }
+}
+
+} // namespace cnes
@@ -0,0 +1,36 @@
+#ifndef CNES_INPUT_SCRIPT_H
+#define CNES_INPUT_SCRIPT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cnes {
+
+class Bus;
+
+// 文本输入脚本：每行 "<帧号> <手柄1> [手柄2]"，'#' 开头为注释
+// 按键写作 A+B+START 形式或十六进制 0x81，"-" 表示不按；每行从该帧开始生效，直到下一行
+class InputScript {
+public:
+    struct Event {
+        uint32_t frame;
+        uint8_t buttons[2];
+    };
+
+    bool load(const std::string& filename);
+
+    // 把第frame帧生效的按键设置到总线，须按帧号递增调用
+    void apply(Bus& bus, uint32_t frame);
+
+    // 解析一个手柄的按键
+    static bool parse_buttons(const std::string& text, uint8_t& buttons);
+
+private:
+    std::vector<Event> events_;
+    size_t next_ = 0;
+};
+
+} // namespace cnes
+
+#endif // CNES_INPUT_SCRIPT_H
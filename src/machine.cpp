@@ -0,0 +1,39 @@
+#include "machine.h"
+
+namespace cnes {
+
+namespace {
+
+template <typename MapperT>
+std::unique_ptr<Machine> make_system(std::shared_ptr<const RomImage> image) {
+    auto system = std::make_unique<System<MapperT>>();
+    if (!system->load(std::move(image))) {
+        return nullptr;
+    }
+    return system;
+}
+
+} // namespace
+
+std::unique_ptr<Machine> Machine::create(std::shared_ptr<const RomImage> image) {
+    if (!image) {
+        return nullptr;
+    }
+
+    switch (Cartridge::peek_mapper_id(*image)) {
+        case Mapper000::ID:
+            return make_system<Mapper000>(std::move(image));
+        case Mapper001::ID:
+            return make_system<Mapper001>(std::move(image));
+        case Mapper002::ID:
+            return make_system<Mapper002>(std::move(image));
+        case Mapper003::ID:
+            return make_system<Mapper003>(std::move(image));
+        case Mapper004::ID:
+            return make_system<Mapper004>(std::move(image));
+        default:
+            return make_system<Mapper>(std::move(image));
+    }
+}
+
+} // namespace cnes
@@ -0,0 +1,106 @@
+#ifndef CNES_MACHINE_H
+#define CNES_MACHINE_H
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "bus.h"
+#include "cartridge.h"
+#include "rom_image.h"
+
+namespace cnes {
+
+// 一台完整的NES：总线、CPU、PPU、APU和卡带
+// 接口按帧调用，具体机型由System<MapperT>实现
+class Machine {
+public:
+    virtual ~Machine() = default;
+
+    // 按ROM中的Mapper号选择具体机型；常见Mapper使用特化实例，其余走虚函数路径
+    // ROM无效或Mapper不支持时返回nullptr
+    static std::unique_ptr<Machine> create(std::shared_ptr<const RomImage> image);
+
+    virtual Bus& bus() = 0;
+    virtual CPU& cpu() = 0;
+    virtual PPU& ppu() = 0;
+    virtual APU& apu() = 0;
+    virtual Cartridge& cartridge() = 0;
+
+    // 复制出一台独立的机器：共享只读的ROM映像，可变状态经一块连续的存档缓冲复制，
+    // 当前画面一并复制。不修改原机器，多个线程可同时从同一台机器分支
+    // 用于搜索/规划中从同一状态反复分支，失败时返回nullptr
+    virtual std::unique_ptr<Machine> clone() const = 0;
+
+    void reset() { bus().reset(); }
+    void run_frame() { bus().run_frame(); }
+    void set_controller(uint8_t port, uint8_t buttons) { bus().set_controller(port, buttons); }
+    uint8_t* screen() { return ppu().get_screen(); }
+    const uint8_t* emphasis() { return ppu().get_emphasis(); }
+};
+
+// 针对具体Mapper实例化的机器
+// MapperT为final类时，卡带访问直接调用MapperT的实现；MapperT为Mapper时走虚函数
+template <typename MapperT>
+class System final : public Machine {
+public:
+    System() {
+        bus_.connect_cartridge(&cartridge_);
+        bus_.connect_cpu(&cpu_);
+        bus_.connect_apu(&apu_);
+        bus_.connect_ppu(&ppu_);
+    }
+
+    bool load(std::shared_ptr<const RomImage> image) {
+        // NSF没有画面，由NsfPlayer播放
+        if (!cartridge_.load_image(std::move(image)) || cartridge_.nsf()) {
+            return false;
+        }
+        if constexpr (!std::is_same<MapperT, Mapper>::value) {
+            if (cartridge_.mapper_id() != MapperT::ID) {
+                return false;
+            }
+        }
+        cartridge_.template specialize<MapperT>();
+        bus_.reset();
+        return true;
+    }
+
+    Bus& bus() override { return bus_; }
+    CPU& cpu() override { return cpu_; }
+    PPU& ppu() override { return ppu_; }
+    APU& apu() override { return apu_; }
+    Cartridge& cartridge() override { return cartridge_; }
+
+    std::unique_ptr<Machine> clone() const override {
+        auto copy = std::make_unique<System<MapperT>>();
+        if (!copy->cartridge_.load_image(cartridge_.image())) {
+            return nullptr;
+        }
+        copy->cartridge_.template specialize<MapperT>();
+        copy->bus_.set_region(bus_.region());
+
+        // 存档缓冲每个线程一块，在多次复制间复用
+        thread_local std::vector<uint8_t> state;
+        state.resize(bus_.state_size());
+        if (!bus_.snapshot(state.data(), state.size()) ||
+            !copy->bus_.load_state(state.data(), state.size())) {
+            return nullptr;
+        }
+        copy->ppu_.copy_frame(ppu_);
+        return copy;
+    }
+
+    MapperT& mapper() { return static_cast<MapperT&>(*cartridge_.mapper()); }
+
+private:
+    Bus bus_;
+    CPU cpu_;
+    PPU ppu_;
+    APU apu_;
+    Cartridge cartridge_;
+};
+
+} // namespace cnes
+
+#endif // CNES_MACHINE_H
@@ -1,57 +1,230 @@
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
 #include <iostream>
-#include "bus.h"
-#include "cartridge.h"
+#include <memory>
+#include <thread>
+#include <vector>
+#include "machine.h"
 #include "test_rom.h"
 #include "display.h"
+#include "audio.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "movie.h"
+#include "observation.h"
+#include "trace.h"
+#include "triple_buffer.h"
 
 using namespace cnes;
 
-int main(int argc, char* argv[]) {
-    Bus bus;
-    CPU cpu;
-    PPU ppu;
-    APU apu;
-    Display display;
+namespace {
 
-    Cartridge cartridge;
-    if (!cartridge.load_from_memory(TestROM::get_test_rom_data())) {
-        std::cerr << "ROM加载失败" << std::endl;
-        return -1;
+// 键盘到手柄1的映射
+const struct { SDL_Scancode key; uint8_t button; } KEY_MAP[] = {
+    {SDL_SCANCODE_Z, BUTTON_A},
+    {SDL_SCANCODE_X, BUTTON_B},
+    {SDL_SCANCODE_RSHIFT, BUTTON_SELECT},
+    {SDL_SCANCODE_RETURN, BUTTON_START},
+    {SDL_SCANCODE_UP, BUTTON_UP},
+    {SDL_SCANCODE_DOWN, BUTTON_DOWN},
+    {SDL_SCANCODE_LEFT, BUTTON_LEFT},
+    {SDL_SCANCODE_RIGHT, BUTTON_RIGHT},
+};
+
+uint8_t read_keyboard(const Uint8* keys) {
+    uint8_t buttons = 0;
+    for (const auto& entry : KEY_MAP) {
+        if (keys[entry.key]) {
+            buttons |= entry.button;
+        }
     }
+    return buttons;
+}
+
+// 输出采样率
+constexpr int AUDIO_SAMPLE_RATE = 48000;
 
-    // temp for debugging
-    bool load_ok = cartridge.load("/Users/fuzhongqing/Downloads/test.nes");
-    if (!load_ok)
+// 交给显示线程的一帧
+struct Frame {
+    uint8_t screen[256 * 240];
+    uint8_t emphasis[240];
+};
+
+// 退出或崩溃时写出指令跟踪
+std::unique_ptr<TraceBuffer> g_trace;
+const char* g_trace_path = nullptr;
+
+void save_trace() {
+    if (g_trace && g_trace_path) {
+        g_trace->save(g_trace_path);
+    }
+}
+
+// 信号处理函数中只用open/write/close（见TraceBuffer::save_raw）
+void on_crash(int sig) {
+    if (g_trace && g_trace_path) {
+        int fd = ::open(g_trace_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            g_trace->save_raw(fd);
+            ::close(fd);
+        }
+    }
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // 命令行：cnes [rom.nes] [--trace 文件 [--trace-size log2记录数]] [--runahead 帧数] [--record 录像] [--export-shm 共享内存名] [--palette 调色板.pal]
+    const char* rom_path = nullptr;
+    uint32_t trace_size_log2 = 20;
+    uint32_t runahead_frames = 0;
+    const char* record_path = nullptr;
+    const char* shm_name = nullptr;
+    const char* palette_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            g_trace_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--trace-size") == 0 && i + 1 < argc) {
+            trace_size_log2 = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--export-shm") == 0 && i + 1 < argc) {
+            shm_name = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--palette") == 0 && i + 1 < argc) {
+            palette_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--runahead") == 0 && i + 1 < argc) {
+            runahead_frames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            rom_path = argv[i];
+        }
+    }
+
+    Display display;
+
+    std::shared_ptr<const RomImage> image = rom_path ? RomImage::open(rom_path)
+                                                     : RomImage::from_memory(TestROM::get_test_rom_data());
+    std::unique_ptr<Machine> machine = Machine::create(image);
+    if (!machine)
     {
       std::cerr << "ROM load fail" << std::endl;
       return -1;
     }
 
-    bus.connect_cartridge(&cartridge);
-    bus.connect_cpu(&cpu);
-    bus.connect_apu(&apu);
-    bus.connect_ppu(&ppu);
-    bus.reset();
+    if (g_trace_path) {
+        g_trace = std::make_unique<TraceBuffer>(trace_size_log2);
+        machine->cpu().set_trace(g_trace.get());
+        std::atexit(save_trace);
+        std::signal(SIGSEGV, on_crash);
+        std::signal(SIGABRT, on_crash);
+        std::signal(SIGFPE, on_crash);
+    }
 
     if (!display.init("cNES", 256, 240, 3)) {
         std::cerr << "显示系统初始化失败" << std::endl;
         return -1;
     }
+    if (palette_path && !display.palette().load(palette_path)) {
+        std::cerr << "调色板读取失败: " << palette_path << std::endl;
+    }
+
+    // 没有声卡时照常运行，只是没有声音
+    Audio audio;
+    if (audio.init(AUDIO_SAMPLE_RATE)) {
+        machine->apu().set_sample_rate(audio.sample_rate());
+    }
+    else {
+        std::cerr << "音频初始化失败" << std::endl;
+    }
+
+    // 按住退格键倒带（录像时不可用）
+    RewindBuffer rewind(machine->bus());
+    RunAhead runahead(*machine, runahead_frames);
+    Movie movie(Movie::rom_hash(*image), 1);
+
+    // 每帧把画面和工作RAM发布到共享内存，供外部进程读取
+    ObservationExport observation;
+    if (shm_name && !observation.open(shm_name)) {
+        std::cerr << "共享内存创建失败: " << shm_name << std::endl;
+    }
+
+    // 模拟在独立线程上按帧率运行，主线程只处理事件和显示，
+    // 画面经三缓冲交给主线程，双方都不会因对方而等待
+    TripleBuffer<Frame> frames;
+    std::atomic<bool> running{true};
+    std::atomic<uint8_t> buttons{0};
+    std::atomic<bool> rewinding{false};
+
+    std::thread emulation([&] {
+        using clock = std::chrono::steady_clock;
+        const auto frame_time = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(1.0 / frame_rate(machine->bus().region())));
+        auto deadline = clock::now();
+        std::vector<int16_t> samples(AUDIO_SAMPLE_RATE / 10);
+
+        while (running.load(std::memory_order_relaxed)) {
+            if (record_path || !rewinding.load(std::memory_order_relaxed) || !rewind.rewind(1)) {
+                machine->set_controller(0, buttons.load(std::memory_order_relaxed));
+                if (record_path) {
+                    movie.record(machine->bus());
+                }
+                runahead.run_frame();
+                rewind.push();
+            }
+            observation.publish(*machine, rewind.frame());
+
+            size_t count = machine->bus().read_samples(samples.data(), samples.size());
+            audio.push(samples.data(), count);
+
+            Frame& frame = frames.back();
+            std::memcpy(frame.screen, machine->screen(), sizeof(frame.screen));
+            std::memcpy(frame.emphasis, machine->emphasis(), sizeof(frame.emphasis));
+            frames.publish();
+
+            // 落后太多（例如被调试器暂停）时不追赶
+            deadline += frame_time;
+            auto now = clock::now();
+            if (deadline < now - frame_time) {
+                deadline = now;
+            }
+            std::this_thread::sleep_until(deadline);
+        }
+    });
 
-    bool running = true;
     while (running) {
-        running = display.handle_events();
+        if (!display.handle_events()) {
+            running = false;
+            break;
+        }
 
-        bus.clock();
+        const Uint8* keys = SDL_GetKeyboardState(nullptr);
+        buttons.store(read_keyboard(keys), std::memory_order_relaxed);
+        rewinding.store(keys[SDL_SCANCODE_BACKSPACE] != 0, std::memory_order_relaxed);
 
-        if (ppu.frame_complete()) {
-          uint8_t* screen_data = ppu.get_screen();
-            
-          display.update_screen(screen_data);
-          ppu.clear_frame_complete();
+        if (frames.update()) {
+            display.update_screen(frames.front().screen, frames.front().emphasis);
+        }
+        else {
+            SDL_Delay(1);
         }
     }
+    emulation.join();
+
+    if (record_path && !movie.save(record_path)) {
+        std::cerr << "录像保存失败: " << record_path << std::endl;
+    }
 
     return 0;
 }
-
@@ -0,0 +1,187 @@
+#include "mapper.h"
+
+namespace cnes {
+
+namespace {
+
+// bank号取模，负数从末尾倒数
+size_t wrap_bank(int bank, size_t count) {
+    if (count == 0) {
+        return 0;
+    }
+    int wrapped = bank % static_cast<int>(count);
+    return static_cast<size_t>(wrapped < 0 ? wrapped + static_cast<int>(count) : wrapped);
+}
+
+} // namespace
+
+Mapper::Mapper(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode, size_t prg_ram_size)
+    : prg_rom_(prg_rom), chr_rom_(chr_rom), prg_ram_(prg_ram_size), mirror_mode_(mirror_mode) {
+    // 如果没有CHR-ROM，则分配8KB CHR-RAM
+    if (chr_rom_.empty()) {
+        chr_ram_.resize(0x2000);
+    }
+
+    // 上电时按顺序映射，各Mapper在构造函数中再切换到自己的初始bank
+    for (int slot = 0; slot < 4; slot++) {
+        set_prg_8k(slot, slot);
+    }
+    set_chr_8k(0);
+}
+
+void Mapper::set_prg_8k(int slot, int bank) {
+    if (prg_rom_.empty()) {
+        return;
+    }
+    const uint8_t* data = prg_rom_.data + wrap_bank(bank, prg_bank_count()) * 0x2000;
+    if (prg_map_[slot] != data) {
+        prg_map_[slot] = data;
+        map_prg_slot(slot);
+    }
+}
+
+void Mapper::set_prg_16k(int slot, int bank) {
+    // 16KB bank号换算成8KB，负数时仍按16KB从末尾倒数
+    int count = static_cast<int>(prg_bank_count() / 2);
+    int index = static_cast<int>(wrap_bank(bank, count > 0 ? count : 1));
+    set_prg_8k(slot * 2, index * 2);
+    set_prg_8k(slot * 2 + 1, index * 2 + 1);
+}
+
+void Mapper::set_prg_32k(int bank) {
+    set_prg_16k(0, bank * 2);
+    set_prg_16k(1, bank * 2 + 1);
+}
+
+void Mapper::set_chr_1k(int slot, int bank) {
+    size_t offset = wrap_bank(bank, chr_bank_count()) * 0x0400;
+    uint8_t* ram = chr_rom_.empty() ? chr_ram_.data() + offset : nullptr;
+    const uint8_t* data = ram ? ram : chr_rom_.data + offset;
+    if (chr_map_[slot] != data) {
+        chr_map_[slot] = data;
+        chr_write_map_[slot] = ram;
+        mark_chr_dirty(static_cast<uint16_t>(slot * 0x0400), 0x0400);
+    }
+}
+
+void Mapper::set_chr_2k(int slot, int bank) {
+    set_chr_1k(slot * 2, bank * 2);
+    set_chr_1k(slot * 2 + 1, bank * 2 + 1);
+}
+
+void Mapper::set_chr_4k(int slot, int bank) {
+    for (int i = 0; i < 4; i++) {
+        set_chr_1k(slot * 4 + i, bank * 4 + i);
+    }
+}
+
+void Mapper::set_chr_8k(int bank) {
+    for (int i = 0; i < 8; i++) {
+        set_chr_1k(i, bank * 8 + i);
+    }
+}
+
+bool Mapper::write_chr(uint16_t addr, uint8_t data) {
+    uint8_t* bank = chr_write_map_[(addr >> 10) & 0x07];
+    if (!bank) {
+        return false;
+    }
+
+    // 只有内容变化时才让对应图块失效
+    uint8_t& cell = bank[addr & 0x03FF];
+    if (cell != data) {
+        cell = data;
+        mark_chr_dirty(addr);
+    }
+    return true;
+}
+
+void Mapper::set_prg_ram_access(bool readable, bool writable) {
+    if (prg_ram_readable_ != readable || prg_ram_writable_ != writable) {
+        prg_ram_readable_ = readable;
+        prg_ram_writable_ = writable;
+        map_prg_ram();
+    }
+}
+
+bool Mapper::read_prg_ram(uint16_t addr, uint8_t& data) const {
+    if (prg_ram_.empty() || !prg_ram_readable_) {
+        return false;
+    }
+    data = prg_ram_[(addr - 0x6000) & (prg_ram_.size() - 1)];
+    return true;
+}
+
+bool Mapper::write_prg_ram(uint16_t addr, uint8_t data) {
+    if (prg_ram_.empty() || !prg_ram_writable_) {
+        return false;
+    }
+    prg_ram_[(addr - 0x6000) & (prg_ram_.size() - 1)] = data;
+    return true;
+}
+
+void Mapper::serialize(StateStream& state) {
+    state(prg_ram_);
+    state(chr_ram_);
+    state(mirror_mode_);
+    state(prg_ram_readable_);
+    state(prg_ram_writable_);
+
+    const uint8_t* chr_base = chr_rom_.empty() ? chr_ram_.data() : chr_rom_.data;
+    std::array<uint32_t, 4> prg_banks{};
+    std::array<uint32_t, 8> chr_banks{};
+    if (!state.loading()) {
+        for (int slot = 0; slot < 4; slot++) {
+            prg_banks[slot] = prg_map_[slot] ? static_cast<uint32_t>(prg_map_[slot] - prg_rom_.data) : 0;
+        }
+        for (int slot = 0; slot < 8; slot++) {
+            chr_banks[slot] = static_cast<uint32_t>(chr_map_[slot] - chr_base);
+        }
+    }
+    state(prg_banks);
+    state(chr_banks);
+
+    if (state.loading()) {
+        for (int slot = 0; slot < 4; slot++) {
+            if (!prg_rom_.empty()) {
+                prg_map_[slot] = prg_rom_.data + prg_banks[slot] % prg_rom_.size;
+            }
+        }
+        for (int slot = 0; slot < 8; slot++) {
+            size_t offset = chr_size() ? chr_banks[slot] % chr_size() : 0;
+            chr_map_[slot] = chr_base + offset;
+            chr_write_map_[slot] = chr_rom_.empty() ? chr_ram_.data() + offset : nullptr;
+        }
+        map_cpu_pages();
+        mark_chr_dirty(0x0000, 0x2000);
+    }
+}
+
+void Mapper::map_cpu_pages() {
+    map_prg_ram();
+    for (int slot = 0; slot < 4; slot++) {
+        map_prg_slot(slot);
+    }
+}
+
+void Mapper::map_prg_slot(int slot) {
+    if (cpu_pages_ && prg_map_[slot]) {
+        cpu_pages_->map_memory(static_cast<uint16_t>(0x8000 + slot * 0x2000), 0x2000, prg_map_[slot], nullptr);
+    }
+}
+
+void Mapper::map_prg_ram() {
+    if (!cpu_pages_ || prg_ram_.size() != 0x2000) {
+        return;
+    }
+
+    // 可读写时直接访问；只读时写入交给Mapper（被忽略）；关闭时读写都交给Mapper
+    if (prg_ram_readable_) {
+        cpu_pages_->map_memory(0x6000, 0x2000, prg_ram_.data(), prg_ram_writable_ ? prg_ram_.data() : nullptr);
+    }
+    else {
+        cpu_pages_->map_handler(0x6000, 0x2000, PageTable::CARTRIDGE);
+    }
+}
+
+} // namespace cnes
@@ -1,16 +1,32 @@
 #ifndef CNES_MAPPER_H
 #define CNES_MAPPER_H
 
+#include <cstddef>
 #include <cstdint>
+#include <array>
+#include <vector>
+#include "page_table.h"
+#include "rom_image.h"
+#include "state.h"
 
 namespace cnes {
 
 // 基础Mapper类
+// 当前bank以指针表表示：$8000-$FFFF分4个8KB槽，$0000-$1FFF分8个1KB槽
+// 切换bank时更新指针（并同步CPU页表和CHR脏标记），读写只查表，不做除法
 class Mapper {
 public:
-    Mapper() = default;
+    Mapper(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode, size_t prg_ram_size = 0);
     virtual ~Mapper() = default;
 
+    // 镜像模式取值，与Cartridge::MIRROR一致
+    enum MIRROR_MODE : uint8_t {
+        MIRROR_HORIZONTAL,
+        MIRROR_VERTICAL,
+        MIRROR_ONESCREEN_LO,
+        MIRROR_ONESCREEN_HI,
+    };
+
     // 内存映射操作
     virtual bool cpu_read(uint16_t addr, uint8_t& data) = 0;
     virtual bool cpu_write(uint16_t addr, uint8_t data) = 0;
@@ -18,19 +34,146 @@ public:
     virtual bool ppu_write(uint16_t addr, uint8_t data) = 0;
 
     // 镜像模式操作
-    virtual uint8_t mirror_mode() = 0;
+    virtual uint8_t mirror_mode() { return mirror_mode_; }
 
-    // 中断请求
+    // 中断请求：PPU在开启渲染的每条扫描线调用scanline()
     virtual void scanline() { }
     virtual bool irq_state() { return false; }
     virtual void irq_clear() { }
 
+    // 再经过多少次scanline()会产生IRQ（1表示下一次），不会产生时返回-1
+    // 总线据此登记事件，只在IRQ到期时让PPU追赶
+    virtual int32_t scanlines_until_irq() const { return -1; }
+
+    // CHR图块脏标记：$0000-$1FFF每16字节一个图块，每个图块一位
+    // Mapper在CHR-RAM写入或CHR切换bank时标记，PPU只重新解码这些图块
+    static constexpr int CHR_TILE_COUNT = 512;
+    using TileMask = std::array<uint64_t, CHR_TILE_COUNT / 64>;
+
+    bool chr_dirty() const { return chr_dirty_; }
+
+    // 取出并清空脏标记
+    void take_dirty_tiles(TileMask& tiles) {
+        tiles = dirty_tiles_;
+        dirty_tiles_ = {};
+        chr_dirty_ = false;
+    }
+
+    // 存档：bank以偏移保存，读取后重建指针表和CPU页表，CHR整体标记为脏
+    // 有额外寄存器的Mapper先调用基类再追加自己的字段
+    virtual void serialize(StateStream& state);
+
+    // 连接CPU页表，Mapper在切换bank时更新页表项
+    void attach(PageTable* pages) {
+        cpu_pages_ = pages;
+        if (cpu_pages_) {
+            map_cpu_pages();
+        }
+    }
+
 protected:
-    // Mapper配置
-    uint8_t prg_banks_ = 0;
-    uint8_t chr_banks_ = 0;
+    // ROM数据（指向卡带的ROM映像）和RAM
+    RomSpan prg_rom_;
+    RomSpan chr_rom_;
+    std::vector<uint8_t> prg_ram_;    // $6000-$7FFF，可能为空
+    std::vector<uint8_t> chr_ram_;    // 没有CHR-ROM时的8KB CHR-RAM
+    uint8_t mirror_mode_;
+
+    // bank数量（按各自的切换单位），bank号超出时取模
+    size_t prg_bank_count() const { return prg_rom_.size / 0x2000; }
+    size_t chr_bank_count() const { return chr_size() / 0x0400; }
+    size_t chr_size() const { return chr_rom_.empty() ? chr_ram_.size() : chr_rom_.size; }
+
+    // 切换PRG bank：slot为槽号，bank为负时从末尾倒数
+    void set_prg_8k(int slot, int bank);
+    void set_prg_16k(int slot, int bank);
+    void set_prg_32k(int bank);
+
+    // 切换CHR bank
+    void set_chr_1k(int slot, int bank);
+    void set_chr_2k(int slot, int bank);
+    void set_chr_4k(int slot, int bank);
+    void set_chr_8k(int bank);
+
+    // PRG-RAM读写开关
+    void set_prg_ram_access(bool readable, bool writable);
+
+    // 通过当前bank读写
+    uint8_t read_prg(uint16_t addr) const { return prg_map_[(addr >> 13) & 0x03][addr & 0x1FFF]; }
+    uint8_t read_chr(uint16_t addr) const { return chr_map_[(addr >> 10) & 0x07][addr & 0x03FF]; }
+    bool write_chr(uint16_t addr, uint8_t data);
+
+    // $6000-$7FFF PRG-RAM访问（未启用时返回false）
+    bool read_prg_ram(uint16_t addr, uint8_t& data) const;
+    bool write_prg_ram(uint16_t addr, uint8_t data);
+
+    // 把当前bank映射到CPU页表（$6000-$FFFF）
+    virtual void map_cpu_pages();
+
+    PageTable* cpu_pages_ = nullptr;
+
+    // 标记PPU地址[addr, addr + size)内的图块
+    void mark_chr_dirty(uint16_t addr, uint16_t size = 1) {
+        for (uint16_t tile = (addr & 0x1FFF) >> 4; tile <= ((addr & 0x1FFF) + size - 1) >> 4 && tile < CHR_TILE_COUNT; tile++) {
+            dirty_tiles_[tile >> 6] |= 1ull << (tile & 63);
+        }
+        chr_dirty_ = true;
+    }
+
+private:
+    TileMask dirty_tiles_{};
+    bool chr_dirty_ = false;
+
+    // 当前bank指针表
+    std::array<const uint8_t*, 4> prg_map_{};
+    std::array<const uint8_t*, 8> chr_map_{};
+    std::array<uint8_t*, 8> chr_write_map_{};     // CHR-RAM可写，ROM为空
+    bool prg_ram_readable_ = true;
+    bool prg_ram_writable_ = true;
+
+    void map_prg_slot(int slot);
+    void map_prg_ram();
+};
+
+// 卡带访问入口：总线和PPU经由这组函数指针访问Mapper
+// bind<Mapper>走虚函数；bind<具体Mapper>（final类）以普通调用转到其实现（定义在.cpp中，不内联），
+// 只是用一次函数指针间接调用代替空指针检查和虚函数调用，开销与之相当。
+// PRG读写经CPU页表、CHR经PPU图块缓存，走到这里的只有Mapper寄存器写入、未映射页和图块解码
+struct MapperPort {
+    Mapper* mapper = nullptr;
+    bool (*cpu_read)(Mapper*, uint16_t, uint8_t&) = unmapped_read;
+    bool (*cpu_write)(Mapper*, uint16_t, uint8_t) = unmapped_write;
+    bool (*ppu_read)(Mapper*, uint16_t, uint8_t&) = unmapped_read;
+    bool (*ppu_write)(Mapper*, uint16_t, uint8_t) = unmapped_write;
+
+    template <typename MapperT>
+    static MapperPort bind(Mapper* mapper) {
+        MapperPort port;
+        if (!mapper) {
+            return port;
+        }
+        port.mapper = mapper;
+        port.cpu_read = [](Mapper* m, uint16_t addr, uint8_t& data) {
+            return static_cast<MapperT*>(m)->cpu_read(addr, data);
+        };
+        port.cpu_write = [](Mapper* m, uint16_t addr, uint8_t data) {
+            return static_cast<MapperT*>(m)->cpu_write(addr, data);
+        };
+        port.ppu_read = [](Mapper* m, uint16_t addr, uint8_t& data) {
+            return static_cast<MapperT*>(m)->ppu_read(addr, data);
+        };
+        port.ppu_write = [](Mapper* m, uint16_t addr, uint8_t data) {
+            return static_cast<MapperT*>(m)->ppu_write(addr, data);
+        };
+        return port;
+    }
+
+private:
+    // 没有卡带时的空实现
+    static bool unmapped_read(Mapper*, uint16_t, uint8_t&) { return false; }
+    static bool unmapped_write(Mapper*, uint16_t, uint8_t) { return false; }
 };
 
 } // namespace cnes
 
-#endif // CNES_MAPPER_H
\ No newline at end of file
+#endif // CNES_MAPPER_H
@@ -2,20 +2,16 @@
 
 namespace cnes {
 
-Mapper000::Mapper000(const std::vector<uint8_t>& prg_rom, const std::vector<uint8_t>& chr_rom, uint8_t mirror_mode)
-    : prg_rom_(prg_rom), chr_rom_(chr_rom), mirror_mode_(mirror_mode) {
-    // 如果没有CHR-ROM，则分配8KB CHR-RAM
-    if (chr_rom_.empty()) {
-        chr_ram_.resize(0x2000);
-    }
+Mapper000::Mapper000(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode)
+    : Mapper(prg_rom, chr_rom, mirror_mode) {
+    // 16KB PRG-ROM在$8000和$C000各映射一次，32KB直接映射
+    set_prg_32k(0);
+    set_chr_8k(0);
 }
 
 bool Mapper000::cpu_read(uint16_t addr, uint8_t& data) {
-    if (addr >= 0x8000 && addr <= 0xFFFF) {
-        // 对于16KB PRG-ROM，镜像两次
-        // 对于32KB PRG-ROM，直接映射
-        size_t index = (addr - 0x8000) % prg_rom_.size();
-        data = prg_rom_[index];
+    if (addr >= 0x8000) {
+        data = read_prg(addr);
         return true;
     }
     return false;
@@ -27,25 +23,18 @@ bool Mapper000::cpu_write(uint16_t addr, uint8_t data) {
 }
 
 bool Mapper000::ppu_read(uint16_t addr, uint8_t& data) {
-    if (addr >= 0x0000 && addr <= 0x1FFF) {
-        if (!chr_rom_.empty()) {
-            data = chr_rom_[addr];
-        } else {
-            data = chr_ram_[addr];
-        }
+    if (addr <= 0x1FFF) {
+        data = read_chr(addr);
         return true;
     }
     return false;
 }
 
 bool Mapper000::ppu_write(uint16_t addr, uint8_t data) {
-    if (addr >= 0x0000 && addr <= 0x1FFF) {
-        if (chr_rom_.empty()) {
-            chr_ram_[addr] = data;
-            return true;
-        }
+    if (addr <= 0x1FFF) {
+        return write_chr(addr, data);
     }
     return false;
 }
 
-} // namespace cnes
\ No newline at end of file
+} // namespace cnes
@@ -0,0 +1,116 @@
+#include "mapper_001.h"
+
+namespace cnes {
+
+Mapper001::Mapper001(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode)
+    : Mapper(prg_rom, chr_rom, mirror_mode, 0x2000) {
+    update_banks();
+}
+
+bool Mapper001::cpu_read(uint16_t addr, uint8_t& data) {
+    if (addr >= 0x8000) {
+        data = read_prg(addr);
+        return true;
+    }
+    if (addr >= 0x6000) {
+        return read_prg_ram(addr, data);
+    }
+    return false;
+}
+
+bool Mapper001::cpu_write(uint16_t addr, uint8_t data) {
+    if (addr < 0x6000) {
+        return false;
+    }
+    if (addr < 0x8000) {
+        return write_prg_ram(addr, data);
+    }
+
+    // 最高位为1时复位移位寄存器，并固定$C000为最后一个bank
+    if (data & 0x80) {
+        shift_ = 0x10;
+        control_ |= 0x0C;
+        update_banks();
+        return true;
+    }
+
+    bool complete = shift_ & 0x01;
+    shift_ = (shift_ >> 1) | ((data & 0x01) << 4);
+    if (complete) {
+        switch ((addr >> 13) & 0x03) {
+            case 0: control_ = shift_; break;
+            case 1: chr_bank_0_ = shift_; break;
+            case 2: chr_bank_1_ = shift_; break;
+            case 3: prg_bank_ = shift_; break;
+        }
+        shift_ = 0x10;
+        update_banks();
+    }
+    return true;
+}
+
+void Mapper001::serialize(StateStream& state) {
+    Mapper::serialize(state);
+    state(shift_);
+    state(control_);
+    state(chr_bank_0_);
+    state(chr_bank_1_);
+    state(prg_bank_);
+}
+
+bool Mapper001::ppu_read(uint16_t addr, uint8_t& data) {
+    if (addr <= 0x1FFF) {
+        data = read_chr(addr);
+        return true;
+    }
+    return false;
+}
+
+bool Mapper001::ppu_write(uint16_t addr, uint8_t data) {
+    if (addr <= 0x1FFF) {
+        return write_chr(addr, data);
+    }
+    return false;
+}
+
+void Mapper001::update_banks() {
+    static constexpr uint8_t MIRRORS[] = {
+        MIRROR_ONESCREEN_LO, MIRROR_ONESCREEN_HI, MIRROR_VERTICAL, MIRROR_HORIZONTAL
+    };
+    mirror_mode_ = MIRRORS[control_ & 0x03];
+
+    // 512KB PRG（SUROM）用CHR bank 0的第4位选择256KB的一半
+    int outer = prg_rom_.size > 0x40000 ? (chr_bank_0_ & 0x10) : 0;
+    int bank = (prg_bank_ & 0x0F) | outer;
+    switch ((control_ >> 2) & 0x03) {
+        case 0:
+        case 1:
+            // 32KB切换，忽略最低位
+            set_prg_32k(bank >> 1);
+            break;
+        case 2:
+            // $8000固定第一个bank，切换$C000
+            set_prg_16k(0, outer);
+            set_prg_16k(1, bank);
+            break;
+        case 3:
+            // 切换$8000，$C000固定最后一个bank
+            set_prg_16k(0, bank);
+            set_prg_16k(1, outer | 0x0F);
+            break;
+    }
+
+    if (control_ & 0x10) {
+        set_chr_4k(0, chr_bank_0_);
+        set_chr_4k(1, chr_bank_1_);
+    }
+    else {
+        set_chr_8k(chr_bank_0_ >> 1);
+    }
+
+    // PRG bank第4位为1时关闭PRG-RAM
+    bool ram_enabled = !(prg_bank_ & 0x10);
+    set_prg_ram_access(ram_enabled, ram_enabled);
+}
+
+} // namespace cnes
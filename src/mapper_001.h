@@ -0,0 +1,36 @@
+#ifndef CNES_MAPPER_001_H
+#define CNES_MAPPER_001_H
+
+#include "mapper.h"
+
+namespace cnes {
+
+// MMC1 (Mapper 001)
+// 寄存器通过5次串行写入设置，支持PRG 16/32KB和CHR 4/8KB切换、可切换镜像和8KB PRG-RAM
+class Mapper001 final : public Mapper {
+public:
+    static constexpr uint8_t ID = 1;
+
+    Mapper001(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode);
+    ~Mapper001() = default;
+
+    bool cpu_read(uint16_t addr, uint8_t& data) override;
+    bool cpu_write(uint16_t addr, uint8_t data) override;
+    bool ppu_read(uint16_t addr, uint8_t& data) override;
+    bool ppu_write(uint16_t addr, uint8_t data) override;
+
+    void serialize(StateStream& state) override;
+
+private:
+    uint8_t shift_ = 0x10;      // 移位寄存器，起始的1移到最低位时说明已写满5位
+    uint8_t control_ = 0x0C;    // $8000：镜像、PRG模式、CHR模式
+    uint8_t chr_bank_0_ = 0;    // $A000
+    uint8_t chr_bank_1_ = 0;    // $C000
+    uint8_t prg_bank_ = 0;      // $E000
+
+    void update_banks();
+};
+
+} // namespace cnes
+
+#endif // CNES_MAPPER_001_H
@@ -0,0 +1,25 @@
+#ifndef CNES_MAPPER_002_H
+#define CNES_MAPPER_002_H
+
+#include "mapper.h"
+
+namespace cnes {
+
+// UxROM (Mapper 002)
+// $8000切换16KB PRG bank，$C000固定最后一个bank，CHR通常为RAM
+class Mapper002 final : public Mapper {
+public:
+    static constexpr uint8_t ID = 2;
+
+    Mapper002(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode);
+    ~Mapper002() = default;
+
+    bool cpu_read(uint16_t addr, uint8_t& data) override;
+    bool cpu_write(uint16_t addr, uint8_t data) override;
+    bool ppu_read(uint16_t addr, uint8_t& data) override;
+    bool ppu_write(uint16_t addr, uint8_t data) override;
+};
+
+} // namespace cnes
+
+#endif // CNES_MAPPER_002_H
@@ -0,0 +1,42 @@
+#include "mapper_003.h"
+
+namespace cnes {
+
+Mapper003::Mapper003(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode)
+    : Mapper(prg_rom, chr_rom, mirror_mode) {
+    set_prg_32k(0);
+    set_chr_8k(0);
+}
+
+bool Mapper003::cpu_read(uint16_t addr, uint8_t& data) {
+    if (addr >= 0x8000) {
+        data = read_prg(addr);
+        return true;
+    }
+    return false;
+}
+
+bool Mapper003::cpu_write(uint16_t addr, uint8_t data) {
+    if (addr >= 0x8000) {
+        set_chr_8k(data);
+        return true;
+    }
+    return false;
+}
+
+bool Mapper003::ppu_read(uint16_t addr, uint8_t& data) {
+    if (addr <= 0x1FFF) {
+        data = read_chr(addr);
+        return true;
+    }
+    return false;
+}
+
+bool Mapper003::ppu_write(uint16_t addr, uint8_t data) {
+    if (addr <= 0x1FFF) {
+        return write_chr(addr, data);
+    }
+    return false;
+}
+
+} // namespace cnes
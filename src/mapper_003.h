@@ -0,0 +1,25 @@
+#ifndef CNES_MAPPER_003_H
+#define CNES_MAPPER_003_H
+
+#include "mapper.h"
+
+namespace cnes {
+
+// CNROM (Mapper 003)
+// PRG固定，$8000-$FFFF写入切换8KB CHR bank
+class Mapper003 final : public Mapper {
+public:
+    static constexpr uint8_t ID = 3;
+
+    Mapper003(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode);
+    ~Mapper003() = default;
+
+    bool cpu_read(uint16_t addr, uint8_t& data) override;
+    bool cpu_write(uint16_t addr, uint8_t data) override;
+    bool ppu_read(uint16_t addr, uint8_t& data) override;
+    bool ppu_write(uint16_t addr, uint8_t data) override;
+};
+
+} // namespace cnes
+
+#endif // CNES_MAPPER_003_H
@@ -0,0 +1,143 @@
+#include "mapper_004.h"
+
+namespace cnes {
+
+Mapper004::Mapper004(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode)
+    : Mapper(prg_rom, chr_rom, mirror_mode, 0x2000) {
+    update_banks();
+}
+
+bool Mapper004::cpu_read(uint16_t addr, uint8_t& data) {
+    if (addr >= 0x8000) {
+        data = read_prg(addr);
+        return true;
+    }
+    if (addr >= 0x6000) {
+        return read_prg_ram(addr, data);
+    }
+    return false;
+}
+
+bool Mapper004::cpu_write(uint16_t addr, uint8_t data) {
+    if (addr < 0x6000) {
+        return false;
+    }
+    if (addr < 0x8000) {
+        return write_prg_ram(addr, data);
+    }
+
+    // 每8KB一对寄存器，按地址奇偶区分
+    bool even = !(addr & 0x01);
+    switch (addr & 0xE000) {
+        case 0x8000:
+            if (even) {
+                bank_select_ = data;
+            }
+            else {
+                registers_[bank_select_ & 0x07] = data;
+            }
+            update_banks();
+            break;
+        case 0xA000:
+            if (even) {
+                mirror_mode_ = (data & 0x01) ? MIRROR_HORIZONTAL : MIRROR_VERTICAL;
+            }
+            else {
+                // 第7位开启PRG-RAM，第6位禁止写入
+                set_prg_ram_access(data & 0x80, (data & 0x80) && !(data & 0x40));
+            }
+            break;
+        case 0xC000:
+            if (even) {
+                irq_latch_ = data;
+            }
+            else {
+                irq_counter_ = 0;
+                irq_reload_ = true;
+            }
+            break;
+        case 0xE000:
+            if (even) {
+                irq_enabled_ = false;
+                irq_active_ = false;
+            }
+            else {
+                irq_enabled_ = true;
+            }
+            break;
+    }
+    return true;
+}
+
+void Mapper004::serialize(StateStream& state) {
+    Mapper::serialize(state);
+    state(bank_select_);
+    state(registers_);
+    state(irq_latch_);
+    state(irq_counter_);
+    state(irq_reload_);
+    state(irq_enabled_);
+    state(irq_active_);
+}
+
+bool Mapper004::ppu_read(uint16_t addr, uint8_t& data) {
+    if (addr <= 0x1FFF) {
+        data = read_chr(addr);
+        return true;
+    }
+    return false;
+}
+
+bool Mapper004::ppu_write(uint16_t addr, uint8_t data) {
+    if (addr <= 0x1FFF) {
+        return write_chr(addr, data);
+    }
+    return false;
+}
+
+void Mapper004::scanline() {
+    if (irq_counter_ == 0 || irq_reload_) {
+        irq_counter_ = irq_latch_;
+        irq_reload_ = false;
+    }
+    else {
+        irq_counter_--;
+    }
+
+    if (irq_counter_ == 0 && irq_enabled_) {
+        irq_active_ = true;
+    }
+}
+
+int32_t Mapper004::scanlines_until_irq() const {
+    if (!irq_enabled_) {
+        return -1;
+    }
+    // 下一次时钟重新装载时，计数器从latch减到0还需要latch次
+    if (irq_counter_ == 0 || irq_reload_) {
+        return irq_latch_ == 0 ? 1 : irq_latch_ + 1;
+    }
+    return irq_counter_;
+}
+
+void Mapper004::update_banks() {
+    // PRG模式：R6在$8000或$C000，另一处固定为倒数第二个bank
+    bool prg_swap = bank_select_ & 0x40;
+    set_prg_8k(prg_swap ? 2 : 0, registers_[6]);
+    set_prg_8k(1, registers_[7]);
+    set_prg_8k(prg_swap ? 0 : 2, -2);
+    set_prg_8k(3, -1);
+
+    // CHR A12反转：2KB bank在$1000，1KB bank在$0000
+    int flip = (bank_select_ & 0x80) ? 4 : 0;
+    set_chr_1k(0 ^ flip, registers_[0] & 0xFE);
+    set_chr_1k(1 ^ flip, registers_[0] | 0x01);
+    set_chr_1k(2 ^ flip, registers_[1] & 0xFE);
+    set_chr_1k(3 ^ flip, registers_[1] | 0x01);
+    set_chr_1k(4 ^ flip, registers_[2]);
+    set_chr_1k(5 ^ flip, registers_[3]);
+    set_chr_1k(6 ^ flip, registers_[4]);
+    set_chr_1k(7 ^ flip, registers_[5]);
+}
+
+} // namespace cnes
@@ -0,0 +1,45 @@
+#ifndef CNES_MAPPER_004_H
+#define CNES_MAPPER_004_H
+
+#include "mapper.h"
+
+namespace cnes {
+
+// MMC3 (Mapper 004)
+// 8个bank寄存器（2个2KB和4个1KB CHR，2个8KB PRG），可切换镜像，8KB PRG-RAM，扫描线IRQ计数器
+class Mapper004 final : public Mapper {
+public:
+    static constexpr uint8_t ID = 4;
+
+    Mapper004(RomSpan prg_rom, RomSpan chr_rom, uint8_t mirror_mode);
+    ~Mapper004() = default;
+
+    bool cpu_read(uint16_t addr, uint8_t& data) override;
+    bool cpu_write(uint16_t addr, uint8_t data) override;
+    bool ppu_read(uint16_t addr, uint8_t& data) override;
+    bool ppu_write(uint16_t addr, uint8_t data) override;
+
+    void serialize(StateStream& state) override;
+
+    void scanline() override;
+    bool irq_state() override { return irq_active_; }
+    void irq_clear() override { irq_active_ = false; }
+    int32_t scanlines_until_irq() const override;
+
+private:
+    uint8_t bank_select_ = 0;                              // $8000
+    std::array<uint8_t, 8> registers_{0, 2, 4, 5, 6, 7, 0, 1};   // R0-R7
+
+    // IRQ计数器
+    uint8_t irq_latch_ = 0;
+    uint8_t irq_counter_ = 0;
+    bool irq_reload_ = false;
+    bool irq_enabled_ = false;
+    bool irq_active_ = false;
+
+    void update_banks();
+};
+
+} // namespace cnes
+
+#endif // CNES_MAPPER_004_H
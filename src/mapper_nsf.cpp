@@ -0,0 +1,77 @@
+#include "mapper_nsf.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace cnes {
+
+MapperNsf::MapperNsf(RomSpan prg_rom, const NsfInfo& info)
+    : Mapper(prg_rom, RomSpan(), MIRROR_VERTICAL, 0x2000) {
+    // JSR INIT; JMP *; JSR PLAY; JMP *
+    const uint8_t player[] = {
+        0x20, static_cast<uint8_t>(info.init_address), static_cast<uint8_t>(info.init_address >> 8),
+        0x4C, static_cast<uint8_t>(IDLE_INIT), static_cast<uint8_t>(IDLE_INIT >> 8),
+        0x20, static_cast<uint8_t>(info.play_address), static_cast<uint8_t>(info.play_address >> 8),
+        0x4C, static_cast<uint8_t>(IDLE_PLAY), static_cast<uint8_t>(IDLE_PLAY >> 8),
+    };
+    std::copy(std::begin(player), std::end(player), player_.begin());
+
+    for (int slot = 0; slot < 8; slot++) {
+        set_bank(slot, info.bankswitched ? info.banks[slot] : static_cast<uint8_t>(slot));
+    }
+}
+
+void MapperNsf::set_bank(int slot, uint8_t bank) {
+    size_t count = prg_rom_.size / 0x1000;
+    bank_registers_[slot] = bank;
+    banks_[slot] = prg_rom_.data + (count ? bank % count : 0) * 0x1000;
+    if (cpu_pages_) {
+        cpu_pages_->map_memory(static_cast<uint16_t>(0x8000 + slot * 0x1000), 0x1000, banks_[slot], nullptr);
+    }
+}
+
+bool MapperNsf::cpu_read(uint16_t addr, uint8_t& data) {
+    if (addr >= 0x8000) {
+        data = banks_[(addr >> 12) & 0x07][addr & 0x0FFF];
+        return true;
+    }
+    if (addr >= 0x6000) {
+        return read_prg_ram(addr, data);
+    }
+    if ((addr & 0xFF00) == 0x4100) {
+        data = player_[addr & 0xFF];
+        return true;
+    }
+    return false;
+}
+
+bool MapperNsf::cpu_write(uint16_t addr, uint8_t data) {
+    if (addr >= 0x5FF8 && addr <= 0x5FFF) {
+        set_bank(addr & 0x07, data);
+        return true;
+    }
+    if (addr >= 0x6000 && addr < 0x8000) {
+        return write_prg_ram(addr, data);
+    }
+    return false;
+}
+
+void MapperNsf::map_cpu_pages() {
+    Mapper::map_cpu_pages();
+    cpu_pages_->map_memory(0x4100, 0x0100, player_.data(), nullptr);
+    for (int slot = 0; slot < 8; slot++) {
+        cpu_pages_->map_memory(static_cast<uint16_t>(0x8000 + slot * 0x1000), 0x1000, banks_[slot], nullptr);
+    }
+}
+
+void MapperNsf::serialize(StateStream& state) {
+    Mapper::serialize(state);
+    state(bank_registers_);
+    if (state.loading()) {
+        for (int slot = 0; slot < 8; slot++) {
+            set_bank(slot, bank_registers_[slot]);
+        }
+    }
+}
+
+} // namespace cnes
@@ -0,0 +1,63 @@
+#ifndef CNES_MAPPER_NSF_H
+#define CNES_MAPPER_NSF_H
+
+#include <array>
+#include <string>
+#include "mapper.h"
+#include "scheduler.h"
+
+namespace cnes {
+
+// NSF文件头中的曲目信息
+struct NsfInfo {
+    uint8_t song_count = 0;
+    uint8_t start_song = 0;          // 从0开始
+    uint16_t load_address = 0;
+    uint16_t init_address = 0;
+    uint16_t play_address = 0;
+    uint16_t play_speed = 0;         // 调用PLAY的间隔（微秒），按region取NTSC或PAL的值
+    Region region = Region::NTSC;
+    bool bankswitched = false;
+    std::array<uint8_t, 8> banks{};  // $8000-$FFFF各4KB槽的初始bank
+    uint8_t expansion = 0;           // 扩展音源（不支持，写入被忽略）
+    std::string title;
+    std::string artist;
+    std::string copyright;
+};
+
+// NSF播放卡带
+// PRG按4KB分槽，$5FF8-$5FFF切换bank（不切换时按载入地址固定映射），$6000-$7FFF为8KB RAM，
+// 没有CHR。另外在$4100提供一小段调用INIT/PLAY的播放程序，和NSF硬件播放器的做法相同
+class MapperNsf final : public Mapper {
+public:
+    // 播放程序入口：调用后停在各自的空循环
+    static constexpr uint16_t CALL_INIT = 0x4100;
+    static constexpr uint16_t IDLE_INIT = 0x4103;
+    static constexpr uint16_t CALL_PLAY = 0x4106;
+    static constexpr uint16_t IDLE_PLAY = 0x4109;
+
+    // prg_rom为按4KB对齐补齐后的程序数据（见Cartridge::load_nsf）
+    MapperNsf(RomSpan prg_rom, const NsfInfo& info);
+    ~MapperNsf() = default;
+
+    bool cpu_read(uint16_t addr, uint8_t& data) override;
+    bool cpu_write(uint16_t addr, uint8_t data) override;
+    bool ppu_read(uint16_t, uint8_t&) override { return false; }
+    bool ppu_write(uint16_t, uint8_t) override { return false; }
+
+    void serialize(StateStream& state) override;
+
+protected:
+    void map_cpu_pages() override;
+
+private:
+    std::array<uint8_t, 8> bank_registers_{};
+    std::array<const uint8_t*, 8> banks_{};
+    std::array<uint8_t, 0x100> player_{};
+
+    void set_bank(int slot, uint8_t bank);
+};
+
+} // namespace cnes
+
+#endif // CNES_MAPPER_NSF_H
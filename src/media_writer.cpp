@@ -0,0 +1,248 @@
+#include "media_writer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cnes {
+
+namespace {
+
+void put16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+    put16(out, static_cast<uint16_t>(value));
+    put16(out + 2, static_cast<uint16_t>(value >> 16));
+}
+
+constexpr int WIDTH = 256;
+constexpr int HEIGHT = 240;
+
+} // namespace
+
+AsyncWriter::AsyncWriter(size_t max_queued) : max_queued_(std::max<size_t>(max_queued, 1)) {
+}
+
+AsyncWriter::~AsyncWriter() {
+    close();
+}
+
+bool AsyncWriter::open(const std::string& path) {
+    close();
+    standard_output_ = path == "-";
+    file_ = standard_output_ ? stdout : std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    stop_ = false;
+    error_ = false;
+    stalls_ = 0;
+    worker_ = std::thread(&AsyncWriter::worker, this);
+    return true;
+}
+
+bool AsyncWriter::close() {
+    if (!file_) {
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+
+    bool ok = !error_ && std::fflush(file_) == 0;
+    if (!standard_output_) {
+        ok = std::fclose(file_) == 0 && ok;
+    }
+    file_ = nullptr;
+    return ok;
+}
+
+std::vector<uint8_t> AsyncWriter::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        return {};
+    }
+    std::vector<uint8_t> block = std::move(free_.back());
+    free_.pop_back();
+    block.clear();
+    return block;
+}
+
+void AsyncWriter::submit(std::vector<uint8_t> block) {
+    if (!file_) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (queue_.size() >= max_queued_) {
+        // 队列满：等后台线程写完一块，不丢数据
+        stalls_++;
+        cv_.wait(lock, [this] { return queue_.size() < max_queued_; });
+    }
+    queue_.push_back(std::move(block));
+    lock.unlock();
+    cv_.notify_all();
+}
+
+bool AsyncWriter::write_block(std::FILE* file, const std::vector<uint8_t>& block) {
+    return std::fwrite(block.data(), 1, block.size(), file) == block.size();
+}
+
+void AsyncWriter::worker() {
+    bool ok = write_header(file_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break;
+        }
+        std::vector<uint8_t> block = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+        cv_.notify_all();
+
+        // 出错后继续取走数据，模拟线程不会因队列满而卡住
+        if (ok) {
+            ok = write_block(file_, block);
+        }
+
+        lock.lock();
+        free_.push_back(std::move(block));
+    }
+    lock.unlock();
+
+    ok = ok && finish(file_);
+    lock.lock();
+    error_ = !ok;
+}
+
+void WavWriter::write_samples(const int16_t* samples, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    std::vector<uint8_t> block = acquire();
+    block.resize(count * 2);
+    for (size_t i = 0; i < count; i++) {
+        put16(&block[i * 2], static_cast<uint16_t>(samples[i]));
+    }
+    samples_ += count;
+    submit(std::move(block));
+}
+
+bool WavWriter::write_header(std::FILE* file) {
+    // 数据长度未知，先填最大值；能回写时在finish()中改正
+    uint8_t header[44];
+    std::memcpy(header, "RIFF", 4);
+    put32(header + 4, 0xFFFFFFFF);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put32(header + 16, 16);
+    put16(header + 20, 1);                    // PCM
+    put16(header + 22, 1);                    // 单声道
+    put32(header + 24, sample_rate_);
+    put32(header + 28, sample_rate_ * 2);     // 每秒字节数
+    put16(header + 32, 2);                    // 每个采样的字节数
+    put16(header + 34, 16);
+    std::memcpy(header + 36, "data", 4);
+    put32(header + 40, 0xFFFFFFFF);
+    return std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool WavWriter::finish(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+    uint64_t data_bytes = samples_ * 2;
+    if (data_bytes > 0xFFFFFFFF - 36 || std::fseek(file, 4, SEEK_SET) != 0) {
+        return true;    // 管道或超长：保留最大值，多数解码器按流读到结尾
+    }
+
+    uint8_t riff[4];
+    uint8_t data[4];
+    put32(riff, static_cast<uint32_t>(data_bytes + 36));
+    put32(data, static_cast<uint32_t>(data_bytes));
+    bool ok = std::fwrite(riff, 1, 4, file) == 4;
+    ok = ok && std::fseek(file, 40, SEEK_SET) == 0;
+    ok = ok && std::fwrite(data, 1, 4, file) == 4;
+    return ok;
+}
+
+void VideoWriter::write_frame(const uint8_t* screen, const uint8_t* emphasis) {
+    // 每帧：256×240个颜色索引，接着240条扫描线的强调位
+    std::vector<uint8_t> block = acquire();
+    block.resize(WIDTH * HEIGHT + HEIGHT);
+    std::memcpy(block.data(), screen, WIDTH * HEIGHT);
+    if (emphasis) {
+        std::memcpy(block.data() + WIDTH * HEIGHT, emphasis, HEIGHT);
+    }
+    else {
+        std::memset(block.data() + WIDTH * HEIGHT, 0, HEIGHT);
+    }
+    submit(std::move(block));
+}
+
+bool VideoWriter::write_header(std::FILE* file) {
+    if (format_ != Y4M) {
+        return true;
+    }
+    // 帧率以千分之一为单位，像素宽高比8:7
+    unsigned rate = static_cast<unsigned>(frame_rate_ * 1000.0 + 0.5);
+    return std::fprintf(file, "YUV4MPEG2 W%d H%d F%u:1000 Ip A8:7 C420jpeg\n", WIDTH, HEIGHT, rate) > 0;
+}
+
+bool VideoWriter::write_block(std::FILE* file, const std::vector<uint8_t>& block) {
+    argb_.resize(WIDTH * HEIGHT);
+    palette_.convert(block.data(), block.data() + WIDTH * HEIGHT, argb_.data());
+
+    if (format_ == RGB24) {
+        output_.resize(WIDTH * HEIGHT * 3);
+        uint8_t* out = output_.data();
+        for (uint32_t pixel : argb_) {
+            *out++ = static_cast<uint8_t>(pixel >> 16);
+            *out++ = static_cast<uint8_t>(pixel >> 8);
+            *out++ = static_cast<uint8_t>(pixel);
+        }
+        return std::fwrite(output_.data(), 1, output_.size(), file) == output_.size();
+    }
+
+    // BT.601全范围（C420jpeg）：Y逐像素，Cb/Cr取2×2块的平均
+    constexpr int CHROMA = (WIDTH / 2) * (HEIGHT / 2);
+    output_.resize(WIDTH * HEIGHT + CHROMA * 2);
+    uint8_t* luma = output_.data();
+    uint8_t* cb = luma + WIDTH * HEIGHT;
+    uint8_t* cr = cb + CHROMA;
+
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        uint32_t pixel = argb_[i];
+        int r = (pixel >> 16) & 0xFF;
+        int g = (pixel >> 8) & 0xFF;
+        int b = pixel & 0xFF;
+        luma[i] = static_cast<uint8_t>((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+    }
+    for (int y = 0; y < HEIGHT; y += 2) {
+        for (int x = 0; x < WIDTH; x += 2) {
+            int r = 0;
+            int g = 0;
+            int b = 0;
+            for (int i : { y * WIDTH + x, y * WIDTH + x + 1, (y + 1) * WIDTH + x, (y + 1) * WIDTH + x + 1 }) {
+                r += (argb_[i] >> 16) & 0xFF;
+                g += (argb_[i] >> 8) & 0xFF;
+                b += argb_[i] & 0xFF;
+            }
+            // 4个像素之和，系数再除以4
+            int index = (y / 2) * (WIDTH / 2) + x / 2;
+            cb[index] = static_cast<uint8_t>(std::clamp((-11059 * r - 21709 * g + 32768 * b + (128 << 18) + (1 << 17)) >> 18, 0, 255));
+            cr[index] = static_cast<uint8_t>(std::clamp((32768 * r - 27439 * g - 5329 * b + (128 << 18) + (1 << 17)) >> 18, 0, 255));
+        }
+    }
+
+    static const char FRAME[] = "FRAME\n";
+    bool ok = std::fwrite(FRAME, 1, sizeof(FRAME) - 1, file) == sizeof(FRAME) - 1;
+    return ok && std::fwrite(output_.data(), 1, output_.size(), file) == output_.size();
+}
+
+} // namespace cnes
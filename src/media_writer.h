@@ -0,0 +1,122 @@
+#ifndef CNES_MEDIA_WRITER_H
+#define CNES_MEDIA_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "palette.h"
+
+namespace cnes {
+
+// 异步写文件
+// 模拟线程把数据块放进有界队列就返回，后台线程负责转换格式和写盘；
+// 队列满时才等待（磁盘长期跟不上时不至于无限占用内存），等待次数可以查询
+class AsyncWriter {
+public:
+    explicit AsyncWriter(size_t max_queued);
+    virtual ~AsyncWriter();
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    // 打开文件，"-"表示标准输出（可通过管道交给编码器）
+    bool open(const std::string& path);
+
+    // 写完队列中的数据并关闭文件，有写入错误时返回false
+    bool close();
+
+    bool is_open() const { return file_ != nullptr; }
+
+    // 队列满而等待后台线程的次数
+    uint64_t stalls() const { return stalls_; }
+
+protected:
+    // 取一块空缓冲（复用已写完的），填好后交给submit()
+    std::vector<uint8_t> acquire();
+    void submit(std::vector<uint8_t> block);
+
+    // 后台线程：打开后写文件头；逐块转换并写入；关闭前补写文件头等收尾
+    virtual bool write_header(std::FILE*) { return true; }
+    virtual bool write_block(std::FILE* file, const std::vector<uint8_t>& block);
+    virtual bool finish(std::FILE*) { return true; }
+
+    // 派生类析构时先调用，保证后台线程不再调用派生类的函数
+    void shutdown() { close(); }
+
+private:
+    size_t max_queued_;
+    std::FILE* file_ = nullptr;
+    bool standard_output_ = false;
+    std::thread worker_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::vector<uint8_t>> queue_;
+    std::vector<std::vector<uint8_t>> free_;
+    bool stop_ = false;
+    bool error_ = false;
+    uint64_t stalls_ = 0;
+
+    void worker();
+};
+
+// WAV（16位PCM单声道），关闭时补写数据长度；输出到管道时长度字段保留最大值
+class WavWriter : public AsyncWriter {
+public:
+    explicit WavWriter(uint32_t sample_rate, size_t max_queued = 64)
+        : AsyncWriter(max_queued), sample_rate_(sample_rate) { }
+    ~WavWriter() override { shutdown(); }
+
+    void write_samples(const int16_t* samples, size_t count);
+
+    uint64_t samples_written() const { return samples_; }
+
+protected:
+    bool write_header(std::FILE* file) override;
+    bool finish(std::FILE* file) override;
+
+private:
+    uint32_t sample_rate_;
+    uint64_t samples_ = 0;
+};
+
+// 视频帧：Y4M（YUV 4:2:0）或不带文件头的RGB24
+// 模拟线程只复制颜色索引和强调位，调色板和颜色空间转换在后台线程进行
+class VideoWriter : public AsyncWriter {
+public:
+    enum FORMAT {
+        Y4M,
+        RGB24
+    };
+
+    VideoWriter(FORMAT format, double frame_rate, size_t max_queued = 32)
+        : AsyncWriter(max_queued), format_(format), frame_rate_(frame_rate) { }
+    ~VideoWriter() override { shutdown(); }
+
+    Palette& palette() { return palette_; }
+
+    void write_frame(const uint8_t* screen, const uint8_t* emphasis);
+
+protected:
+    bool write_header(std::FILE* file) override;
+    bool write_block(std::FILE* file, const std::vector<uint8_t>& block) override;
+
+private:
+    FORMAT format_;
+    double frame_rate_;
+    Palette palette_;
+
+    // 后台线程的转换缓冲
+    std::vector<uint32_t> argb_;
+    std::vector<uint8_t> output_;
+};
+
+} // namespace cnes
+
+#endif // CNES_MEDIA_WRITER_H
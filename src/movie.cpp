@@ -0,0 +1,133 @@
+#include "movie.h"
+#include "bus.h"
+#include "rom_image.h"
+#include <cstdio>
+#include <cstring>
+
+namespace cnes {
+
+namespace {
+
+// 录像文件头
+struct MovieFileHeader {
+    char magic[4];          // "CNMV"
+    uint32_t version;
+    uint32_t frame_count;
+    uint8_t ports;          // 每帧的字节数（1或2）
+    uint8_t reserved[3];
+    uint64_t rom_hash;      // 整个ROM文件的fnv1a64
+};
+
+static_assert(sizeof(MovieFileHeader) == 24, "movie header must stay 24 bytes");
+
+constexpr char MOVIE_MAGIC[4] = {'C', 'N', 'M', 'V'};
+constexpr uint32_t MOVIE_VERSION = 1;
+
+} // namespace
+
+uint64_t fnv1a64(const uint8_t* data, size_t size, uint64_t hash) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool ends_with(const std::string& text, const char* suffix) {
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+uint64_t Movie::rom_hash(const RomImage& image) {
+    return fnv1a64(image.data(), image.size());
+}
+
+void Movie::record(const Bus& bus) {
+    for (uint8_t port = 0; port < ports_; port++) {
+        inputs_.push_back(bus.controller(port));
+    }
+}
+
+bool Movie::apply(Bus& bus, uint32_t frame) const {
+    if (frame >= frame_count()) {
+        return false;
+    }
+    const uint8_t* input = &inputs_[static_cast<size_t>(frame) * ports_];
+    bus.set_controller(0, input[0]);
+    bus.set_controller(1, ports_ > 1 ? input[1] : 0);
+    return true;
+}
+
+bool Movie::save(const std::string& filename) const {
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    MovieFileHeader header{};
+    std::memcpy(header.magic, MOVIE_MAGIC, sizeof(header.magic));
+    header.version = MOVIE_VERSION;
+    header.frame_count = frame_count();
+    header.ports = ports_;
+    header.rom_hash = rom_hash_;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = ok && std::fwrite(inputs_.data(), 1, inputs_.size(), file) == inputs_.size();
+    ok = std::fclose(file) == 0 && ok;
+    return ok;
+}
+
+bool Movie::load(const std::string& filename) {
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    MovieFileHeader header{};
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+        && std::memcmp(header.magic, MOVIE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == MOVIE_VERSION
+        && (header.ports == 1 || header.ports == 2);
+
+    // 帧数先与文件大小核对，损坏的文件头不会导致分配过大的内存
+    if (ok) {
+        long position = std::ftell(file);
+        ok = position >= 0 && std::fseek(file, 0, SEEK_END) == 0;
+        long end = ok ? std::ftell(file) : -1;
+        ok = ok && end >= position && std::fseek(file, position, SEEK_SET) == 0
+            && static_cast<uint64_t>(header.frame_count) * header.ports == static_cast<uint64_t>(end - position);
+    }
+
+    if (ok) {
+        rom_hash_ = header.rom_hash;
+        ports_ = header.ports;
+        inputs_.resize(static_cast<size_t>(header.frame_count) * ports_);
+        ok = std::fread(inputs_.data(), 1, inputs_.size(), file) == inputs_.size();
+    }
+
+    std::fclose(file);
+    return ok;
+}
+
+Movie::LOAD_RESULT Movie::load_for(const std::string& filename, const RomImage& rom, std::string* error) {
+    if (!load(filename)) {
+        if (error) {
+            *error = "invalid movie file: " + filename;
+        }
+        return INVALID_FILE;
+    }
+
+    uint64_t hash = rom_hash(rom);
+    if (rom_hash_ != hash) {
+        if (error) {
+            char text[96];
+            std::snprintf(text, sizeof(text), "movie was recorded on a different ROM (%016llx, ROM is %016llx)",
+                          static_cast<unsigned long long>(rom_hash_), static_cast<unsigned long long>(hash));
+            *error = text;
+        }
+        return ROM_MISMATCH;
+    }
+    return LOADED;
+}
+
+} // namespace cnes
@@ -0,0 +1,59 @@
+#ifndef CNES_MOVIE_H
+#define CNES_MOVIE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cnes {
+
+class Bus;
+class RomImage;
+
+// 64位FNV-1a散列（ROM校验、回放结果比对）
+uint64_t fnv1a64(const uint8_t* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull);
+
+// 文件名是否以suffix结尾（工具按扩展名区分录像、输入脚本和输出格式）
+bool ends_with(const std::string& text, const char* suffix);
+
+// 输入录像
+// 文件为MovieFileHeader加每帧每个手柄一个字节的按键，文件头中记录ROM散列，
+// 回放时从上电开始逐帧设置按键，同一ROM上结果完全确定
+class Movie {
+public:
+    Movie() = default;
+    Movie(uint64_t rom_hash, uint8_t ports) : rom_hash_(rom_hash), ports_(ports == 1 ? 1 : 2) { }
+
+    static uint64_t rom_hash(const RomImage& image);
+
+    // 追加一帧：记录总线上当前设置的按键
+    void record(const Bus& bus);
+
+    // 把第frame帧的按键设置到总线，超出录像长度时返回false
+    bool apply(Bus& bus, uint32_t frame) const;
+
+    uint64_t rom_hash() const { return rom_hash_; }
+    uint8_t ports() const { return ports_; }
+    uint32_t frame_count() const { return static_cast<uint32_t>(inputs_.size() / ports_); }
+
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename);
+
+    // 读取录像并核对是否录制于rom，失败时error为可直接输出的原因
+    enum LOAD_RESULT {
+        LOADED,
+        INVALID_FILE,
+        ROM_MISMATCH
+    };
+    LOAD_RESULT load_for(const std::string& filename, const RomImage& rom, std::string* error = nullptr);
+
+private:
+    uint64_t rom_hash_ = 0;
+    uint8_t ports_ = 1;
+    std::vector<uint8_t> inputs_;
+};
+
+} // namespace cnes
+
+#endif // CNES_MOVIE_H
@@ -0,0 +1,90 @@
+#include "nsf_player.h"
+
+#include <algorithm>
+
+namespace cnes {
+
+namespace {
+
+// 主时钟频率
+constexpr double MASTER_CLOCK_NTSC = 236.25e6 / 11.0;
+constexpr double MASTER_CLOCK_PAL = 26.6017125e6;
+
+// CPU在PLAY中时每次最多运行的CPU周期，之后检查是否已返回空循环
+constexpr uint64_t SLICE_CYCLES = 512;
+
+} // namespace
+
+NsfPlayer::NsfPlayer() {
+    bus_.connect_cartridge(&cartridge_);
+    bus_.connect_cpu(&cpu_);
+    bus_.connect_apu(&apu_);
+}
+
+bool NsfPlayer::load(std::shared_ptr<const RomImage> image) {
+    if (!cartridge_.load_image(std::move(image)) || !cartridge_.nsf()) {
+        return false;
+    }
+    cartridge_.specialize<MapperNsf>();
+    bus_.set_region(info().region);
+
+    double master_clock = info().region == Region::NTSC ? MASTER_CLOCK_NTSC : MASTER_CLOCK_PAL;
+    double seconds = info().play_speed ? info().play_speed / 1e6 : 1.0 / frame_rate(info().region);
+    play_period_ = std::max<uint64_t>(static_cast<uint64_t>(seconds * master_clock + 0.5), bus_.ratio().cpu_divider);
+
+    start(info().start_song);
+    return true;
+}
+
+double NsfPlayer::play_rate() const {
+    double master_clock = info().region == Region::NTSC ? MASTER_CLOCK_NTSC : MASTER_CLOCK_PAL;
+    return master_clock / play_period_;
+}
+
+void NsfPlayer::start(uint8_t song) {
+    // 卡带恢复上电时的bank并清空$6000-$7FFF，再清空内部RAM
+    cartridge_.reset();
+    bus_.reset();
+    for (uint16_t addr = 0x0000; addr < 0x0800; addr++) {
+        bus_.write(addr, 0x00);
+    }
+
+    // 初始化APU：关闭各声道后打开，帧计数器不产生IRQ
+    for (uint16_t addr = 0x4000; addr <= 0x4013; addr++) {
+        bus_.write(addr, 0x00);
+    }
+    bus_.write(0x4015, 0x00);
+    bus_.write(0x4015, 0x0F);
+    bus_.write(0x4017, 0x40);
+
+    // A为曲目号，X为制式，INIT返回后才开始调用PLAY
+    cpu_.jump(MapperNsf::CALL_INIT, song, info().region == Region::NTSC ? 0 : 1);
+    next_play_ = bus_.timestamp();
+}
+
+bool NsfPlayer::idle() const {
+    if (cpu_.jammed()) {
+        return true;
+    }
+    return cpu_.interrupts_disabled() &&
+           (cpu_.pc() == MapperNsf::IDLE_INIT || cpu_.pc() == MapperNsf::IDLE_PLAY);
+}
+
+void NsfPlayer::run_frame() {
+    // PLAY超过一个间隔还没返回时不重入，等它返回后的下一个间隔再调用
+    if (cpu_.pc() == MapperNsf::IDLE_INIT || cpu_.pc() == MapperNsf::IDLE_PLAY) {
+        cpu_.jump(MapperNsf::CALL_PLAY, 0, 0);
+    }
+    next_play_ += play_period_;
+
+    uint64_t slice = SLICE_CYCLES * bus_.ratio().cpu_divider;
+    while (bus_.timestamp() < next_play_) {
+        if (idle()) {
+            bus_.skip_until(next_play_);
+            break;
+        }
+        bus_.run_until(std::min(next_play_, bus_.timestamp() + slice));
+    }
+}
+
+} // namespace cnes
@@ -0,0 +1,63 @@
+#ifndef CNES_NSF_PLAYER_H
+#define CNES_NSF_PLAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "bus.h"
+#include "cartridge.h"
+#include "rom_image.h"
+
+namespace cnes {
+
+// NSF播放器
+// 只有CPU、APU和卡带，不连接PPU。CPU执行完INIT/PLAY后停在播放程序的空循环，
+// 到下一次调用PLAY之前的时间直接跳过；APU只在取采样时追赶，跳过的时间不需要逐条执行指令
+class NsfPlayer {
+public:
+    NsfPlayer();
+    ~NsfPlayer() = default;
+
+    NsfPlayer(const NsfPlayer&) = delete;
+    NsfPlayer& operator=(const NsfPlayer&) = delete;
+
+    // 加载NSF文件，不是有效的NSF时返回false
+    bool load(std::shared_ptr<const RomImage> image);
+
+    const NsfInfo& info() const { return *cartridge_.nsf(); }
+
+    // 输出采样率，0表示不输出声音
+    void set_sample_rate(uint32_t rate) { apu_.set_sample_rate(rate); }
+
+    // 按NSF规定的初始化流程开始播放第song首（从0开始）
+    void start(uint8_t song);
+
+    // 运行一个PLAY间隔：上一次PLAY已返回时调用PLAY，然后运行到下一次调用的时刻
+    void run_frame();
+
+    // 每秒调用PLAY的次数
+    double play_rate() const;
+
+    // 读出已合成的采样
+    size_t read_samples(int16_t* out, size_t count) { return bus_.read_samples(out, count); }
+
+    Bus& bus() { return bus_; }
+    CPU& cpu() { return cpu_; }
+    APU& apu() { return apu_; }
+
+private:
+    Bus bus_;
+    CPU cpu_;
+    APU apu_;
+    Cartridge cartridge_;
+
+    uint64_t play_period_ = 0;    // PLAY间隔（主时钟）
+    uint64_t next_play_ = 0;      // 下一次调用PLAY的时间戳
+
+    // CPU停在空循环（或锁死）且不会响应IRQ，可以跳过时间
+    bool idle() const;
+};
+
+} // namespace cnes
+
+#endif // CNES_NSF_PLAYER_H
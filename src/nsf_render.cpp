@@ -0,0 +1,151 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "media_writer.h"
+#include "nsf_player.h"
+#include "work_pool.h"
+
+using namespace cnes;
+
+namespace {
+
+struct TrackResult {
+    const char* error = nullptr;
+    uint64_t samples = 0;
+    double seconds = 0.0;
+};
+
+// 每首曲目一个独立的播放器，只共享只读的NSF映像；output为空时只合成不写文件
+void render_track(const std::shared_ptr<const RomImage>& image, uint8_t song, double duration,
+                  uint32_t rate, const std::string& output, TrackResult& result) {
+    NsfPlayer player;
+    if (!player.load(image)) {
+        result.error = "invalid NSF";
+        return;
+    }
+    player.set_sample_rate(rate);
+
+    WavWriter wav(rate);
+    if (!output.empty() && !wav.open(output)) {
+        result.error = "cannot open output";
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    player.start(song);
+    std::vector<int16_t> samples(rate / 10);
+    uint64_t frames = static_cast<uint64_t>(duration * player.play_rate() + 0.5);
+    for (uint64_t frame = 0; frame < frames; frame++) {
+        player.run_frame();
+        size_t count = player.read_samples(samples.data(), samples.size());
+        result.samples += count;
+        if (wav.is_open()) {
+            wav.write_samples(samples.data(), count);
+        }
+    }
+    if (!wav.close()) {
+        result.error = "write error";
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// 无界面渲染NSF：各曲目在线程池上并行，写成<prefix>_NN.wav
+int main(int argc, char* argv[]) {
+    const char* path = nullptr;
+    const char* prefix = nullptr;
+    int track = 0;              // 从1开始，0表示全部曲目
+    double duration = 120.0;
+    uint32_t rate = 48000;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--track") == 0 && i + 1 < argc) {
+            track = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            duration = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            path = argv[i];
+        }
+    }
+    if (!path || rate == 0) {
+        std::fprintf(stderr, "usage: %s <file.nsf> [--track N] [--seconds S] [--out prefix] [--rate HZ] [--threads N]\n",
+                     argv[0]);
+        return 1;
+    }
+
+    std::shared_ptr<const RomImage> image = RomImage::open(path);
+    NsfPlayer probe;
+    if (!image || !probe.load(image)) {
+        std::fprintf(stderr, "cannot load NSF: %s\n", path);
+        return 1;
+    }
+    const NsfInfo& info = probe.info();
+    if (track < 0 || track > info.song_count) {
+        std::fprintf(stderr, "track must be 1-%u\n", info.song_count);
+        return 1;
+    }
+
+    std::printf("title:       %s\n", info.title.c_str());
+    std::printf("artist:      %s\n", info.artist.c_str());
+    std::printf("copyright:   %s\n", info.copyright.c_str());
+    std::printf("tracks:      %u, %s, %.2f Hz play rate%s\n", info.song_count,
+                info.region == Region::NTSC ? "NTSC" : "PAL", probe.play_rate(),
+                info.expansion ? " (expansion audio not emulated)" : "");
+
+    std::vector<uint8_t> songs;
+    for (int song = 0; song < info.song_count; song++) {
+        if (track == 0 || track == song + 1) {
+            songs.push_back(static_cast<uint8_t>(song));
+        }
+    }
+
+    std::vector<TrackResult> results(songs.size());
+    auto start = std::chrono::steady_clock::now();
+    WorkPool pool(threads);
+    for (size_t i = 0; i < songs.size(); i++) {
+        std::string output;
+        if (prefix) {
+            char name[16];
+            std::snprintf(name, sizeof(name), "_%02u.wav", songs[i] + 1);
+            output = prefix + std::string(name);
+        }
+        pool.submit([&image, &songs, &results, i, duration, rate, output] {
+            render_track(image, songs[i], duration, rate, output, results[i]);
+        });
+    }
+    pool.wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    double total_audio = 0.0;
+    for (size_t i = 0; i < songs.size(); i++) {
+        const TrackResult& result = results[i];
+        if (result.error) {
+            std::printf("track %3u:   FAIL: %s\n", songs[i] + 1, result.error);
+            failed++;
+            continue;
+        }
+        double audio = static_cast<double>(result.samples) / rate;
+        total_audio += audio;
+        std::printf("track %3u:   %.1f s audio in %.3f s (%.0fx real time)\n", songs[i] + 1, audio,
+                    result.seconds, result.seconds > 0.0 ? audio / result.seconds : 0.0);
+    }
+    std::printf("total:       %.1f s audio, %u threads, wall time %.3f s (%.0fx real time)\n", total_audio,
+                pool.thread_count(), seconds, seconds > 0.0 ? total_audio / seconds : 0.0);
+    return failed ? 1 : 0;
+}
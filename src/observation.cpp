@@ -0,0 +1,173 @@
+#include "observation.h"
+#include "machine.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cnes {
+
+namespace {
+
+constexpr char OBSERVATION_MAGIC[8] = {'C', 'N', 'E', 'S', 'O', 'B', 'S', '\0'};
+constexpr uint32_t OBSERVATION_VERSION = 1;
+
+// 槽中还没有写过数据
+constexpr uint32_t EMPTY_SEQUENCE = 0;
+
+} // namespace
+
+ObservationExport::~ObservationExport() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool ObservationExport::open(const std::string&) { return false; }
+void ObservationExport::close() { }
+
+bool ObservationReader::open(const std::string&) { return false; }
+void ObservationReader::close() { }
+
+#else
+
+bool ObservationExport::open(const std::string& name) {
+    close();
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, sizeof(ObservationSegment)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, sizeof(ObservationSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    // 由写端初始化，序列号和latest清零（全0即为有效的原子变量初值）
+    segment_ = static_cast<ObservationSegment*>(mapping);
+    std::memset(static_cast<void*>(segment_), 0, sizeof(ObservationSegment));
+    std::memcpy(segment_->magic, OBSERVATION_MAGIC, sizeof(segment_->magic));
+    segment_->version = OBSERVATION_VERSION;
+    segment_->slot_size = sizeof(ObservationSlot);
+    name_ = name;
+    return true;
+}
+
+void ObservationExport::close() {
+    if (segment_) {
+        munmap(segment_, sizeof(ObservationSegment));
+        shm_unlink(name_.c_str());
+        segment_ = nullptr;
+    }
+}
+
+bool ObservationReader::open(const std::string& name) {
+    close();
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ObservationSegment)) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, sizeof(ObservationSegment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    const ObservationSegment* segment = static_cast<const ObservationSegment*>(mapping);
+    if (std::memcmp(segment->magic, OBSERVATION_MAGIC, sizeof(segment->magic)) != 0 ||
+        segment->version != OBSERVATION_VERSION || segment->slot_size != sizeof(ObservationSlot)) {
+        munmap(mapping, sizeof(ObservationSegment));
+        return false;
+    }
+    segment_ = segment;
+    return true;
+}
+
+void ObservationReader::close() {
+    if (segment_) {
+        munmap(const_cast<ObservationSegment*>(segment_), sizeof(ObservationSegment));
+        segment_ = nullptr;
+    }
+}
+
+#endif
+
+void ObservationExport::publish(Machine& machine, uint64_t frame) {
+    if (!segment_) {
+        return;
+    }
+
+    // 写另一个槽，读端此时仍可完整读取latest指向的槽
+    uint32_t index = segment_->latest.load(std::memory_order_relaxed) ^ 1;
+    ObservationSlot& slot = segment_->slots[index];
+    uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.frame = frame;
+    std::memcpy(slot.screen, machine.screen(), sizeof(slot.screen));
+    std::memcpy(slot.ram, machine.bus().ram().data(), sizeof(slot.ram));
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    segment_->latest.store(index, std::memory_order_release);
+}
+
+ObservationReader::~ObservationReader() {
+    close();
+}
+
+const ObservationSlot* ObservationReader::begin(uint32_t& sequence) const {
+    if (!segment_) {
+        return nullptr;
+    }
+    for (;;) {
+        const ObservationSlot* slot = &segment_->slots[segment_->latest.load(std::memory_order_acquire)];
+        sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == EMPTY_SEQUENCE) {
+            return nullptr;
+        }
+        if (!(sequence & 1)) {
+            return slot;
+        }
+    }
+}
+
+bool ObservationReader::valid(const ObservationSlot* slot, uint32_t sequence) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+bool ObservationReader::read(ObservationSlot& out) const {
+    for (;;) {
+        uint32_t sequence;
+        const ObservationSlot* slot = begin(sequence);
+        if (!slot) {
+            return false;
+        }
+        out.frame = slot->frame;
+        std::memcpy(out.screen, slot->screen, sizeof(out.screen));
+        std::memcpy(out.ram, slot->ram, sizeof(out.ram));
+        if (valid(slot, sequence)) {
+            out.sequence.store(sequence, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+} // namespace cnes
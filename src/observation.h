@@ -0,0 +1,81 @@
+#ifndef CNES_OBSERVATION_H
+#define CNES_OBSERVATION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cnes {
+
+class Machine;
+
+// 共享内存中的观测数据：每帧的画面（6位调色板颜色）、2KB工作RAM和帧号
+// 两个槽交替写入，每个槽带一个序列号（seqlock）：写入期间为奇数，写完为偶数。
+// 写端从不等待读端；读端就地读取latest指向的槽，读完后序列号未变即为完整的一帧
+struct ObservationSlot {
+    std::atomic<uint32_t> sequence;
+    uint32_t reserved;
+    uint64_t frame;
+    uint8_t screen[256 * 240];
+    uint8_t ram[0x0800];
+};
+
+struct ObservationSegment {
+    char magic[8];                  // "CNESOBS\0"
+    uint32_t version;
+    uint32_t slot_size;             // sizeof(ObservationSlot)
+    std::atomic<uint32_t> latest;   // 最近写完的槽
+    uint32_t reserved;
+    ObservationSlot slots[2];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "seqlock needs address-free atomics");
+
+// 写端：把机器的观测数据发布到POSIX共享内存对象（名字形如 "/cnes0"）
+class ObservationExport {
+public:
+    ObservationExport() = default;
+    ~ObservationExport();
+
+    ObservationExport(const ObservationExport&) = delete;
+    ObservationExport& operator=(const ObservationExport&) = delete;
+
+    // 创建或打开共享内存对象，不支持的平台返回false
+    bool open(const std::string& name);
+    void close();
+
+    // 发布当前帧（每帧调用一次）
+    void publish(Machine& machine, uint64_t frame);
+
+private:
+    ObservationSegment* segment_ = nullptr;
+    std::string name_;
+};
+
+// 读端：只读映射共享内存，复制出最近一帧
+class ObservationReader {
+public:
+    ObservationReader() = default;
+    ~ObservationReader();
+
+    ObservationReader(const ObservationReader&) = delete;
+    ObservationReader& operator=(const ObservationReader&) = delete;
+
+    bool open(const std::string& name);
+    void close();
+
+    // 就地访问最近一帧：begin()返回槽和序列号，用完后valid()确认期间没有被覆盖
+    const ObservationSlot* begin(uint32_t& sequence) const;
+    bool valid(const ObservationSlot* slot, uint32_t sequence) const;
+
+    // 复制最近一帧，没有数据时返回false
+    bool read(ObservationSlot& out) const;
+
+private:
+    const ObservationSegment* segment_ = nullptr;
+};
+
+} // namespace cnes
+
+#endif // CNES_OBSERVATION_H
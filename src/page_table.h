@@ -0,0 +1,57 @@
+#ifndef CNES_PAGE_TABLE_H
+#define CNES_PAGE_TABLE_H
+
+#include <cstdint>
+#include <array>
+
+namespace cnes {
+
+// CPU地址空间页表，按256字节分页
+// 普通RAM/ROM页保存主机内存指针，总线直接读写；I/O页交给对应的处理器
+class PageTable {
+public:
+    static constexpr int PAGE_SIZE = 256;
+    static constexpr int PAGE_COUNT = 256;
+
+    // 页处理器（指针为空时使用）
+    enum HANDLER : uint8_t {
+        OPEN_BUS,        // 无设备
+        PPU_REGISTERS,   // $2000-$3FFF
+        IO_REGISTERS,    // $4000-$40FF（APU、DMA、手柄）
+        CARTRIDGE        // 交给Mapper处理
+    };
+
+    struct Page {
+        const uint8_t* read = nullptr;   // 可直接读取的主机内存
+        uint8_t* write = nullptr;        // 可直接写入的主机内存（ROM页为空）
+        HANDLER handler = OPEN_BUS;
+    };
+
+    const Page& operator[](uint8_t page) const { return pages_[page]; }
+
+    // 把连续的主机内存映射到[addr, addr + size)，addr和size按页对齐
+    void map_memory(uint16_t addr, uint32_t size, const uint8_t* read, uint8_t* write) {
+        for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+            Page& page = pages_[(addr + offset) >> 8];
+            page.read = read ? read + offset : nullptr;
+            page.write = write ? write + offset : nullptr;
+        }
+    }
+
+    // 把[addr, addr + size)交给处理器，清除直接访问指针
+    void map_handler(uint16_t addr, uint32_t size, HANDLER handler) {
+        for (uint32_t offset = 0; offset < size; offset += PAGE_SIZE) {
+            Page& page = pages_[(addr + offset) >> 8];
+            page.read = nullptr;
+            page.write = nullptr;
+            page.handler = handler;
+        }
+    }
+
+private:
+    std::array<Page, PAGE_COUNT> pages_{};
+};
+
+} // namespace cnes
+
+#endif // CNES_PAGE_TABLE_H
@@ -0,0 +1,263 @@
+#include "palette.h"
+#include <cstdio>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CNES_PALETTE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cnes {
+
+namespace {
+
+// 2C02默认调色板（RGB）
+constexpr uint8_t DEFAULT_PALETTE[64 * 3] = {
+     84,  84,  84,    0,  30, 116,    8,  16, 144,   48,   0, 136,
+     68,   0, 100,   92,   0,  48,   84,   4,   0,   60,  24,   0,
+     32,  42,   0,    8,  58,   0,    0,  64,   0,    0,  60,   0,
+      0,  50,  60,    0,   0,   0,    0,   0,   0,    0,   0,   0,
+    152, 150, 152,    8,  76, 196,   48,  50, 236,   92,  30, 228,
+    136,  20, 176,  160,  20, 100,  152,  34,  32,  120,  60,   0,
+     84,  90,   0,   40, 114,   0,    8, 124,   0,    0, 118,  40,
+      0, 102, 120,    0,   0,   0,    0,   0,   0,    0,   0,   0,
+    236, 238, 236,   76, 154, 236,  120, 124, 236,  176,  98, 236,
+    228,  84, 236,  236,  88, 180,  236, 106, 100,  212, 136,  32,
+    160, 170,   0,  116, 196,   0,   76, 208,  32,   56, 204, 108,
+     56, 180, 204,   60,  60,  60,    0,   0,   0,    0,   0,   0,
+    236, 238, 236,  168, 204, 236,  188, 188, 236,  212, 178, 236,
+    236, 174, 236,  236, 174, 212,  236, 180, 176,  228, 196, 144,
+    204, 210, 120,  180, 222, 120,  168, 226, 144,  152, 226, 180,
+    160, 214, 228,  160, 162, 160,    0,   0,   0,    0,   0,   0,
+};
+
+// 强调位使其余两个通道变暗的系数
+constexpr double EMPHASIS_ATTENUATION = 0.816328;
+
+constexpr int SCREEN_WIDTH = 256;
+constexpr int SCREEN_HEIGHT = 240;
+
+void convert_scalar(const Palette::Table& table, const uint8_t* indices, uint32_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = table.argb[indices[i] & 0x3F];
+    }
+}
+
+#ifdef CNES_PALETTE_X86
+
+// 16个索引查一个颜色平面：低4位用pshufb在4段16字节表中查找，高2位选段
+__attribute__((target("sse4.1")))
+inline __m128i lookup_sse41(const uint8_t* plane, __m128i low, __m128i m1, __m128i m2, __m128i m3) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(plane);
+    __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(p), low);
+    v = _mm_blendv_epi8(v, _mm_shuffle_epi8(_mm_loadu_si128(p + 1), low), m1);
+    v = _mm_blendv_epi8(v, _mm_shuffle_epi8(_mm_loadu_si128(p + 2), low), m2);
+    return _mm_blendv_epi8(v, _mm_shuffle_epi8(_mm_loadu_si128(p + 3), low), m3);
+}
+
+__attribute__((target("sse4.1")))
+void convert_sse41(const Palette::Table& table, const uint8_t* indices, uint32_t* out, size_t count) {
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+    const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+        __m128i low = _mm_and_si128(index, low_mask);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(index, 4), _mm_set1_epi8(0x03));
+        __m128i m1 = _mm_cmpeq_epi8(high, _mm_set1_epi8(1));
+        __m128i m2 = _mm_cmpeq_epi8(high, _mm_set1_epi8(2));
+        __m128i m3 = _mm_cmpeq_epi8(high, _mm_set1_epi8(3));
+
+        __m128i b = lookup_sse41(table.b, low, m1, m2, m3);
+        __m128i g = lookup_sse41(table.g, low, m1, m2, m3);
+        __m128i r = lookup_sse41(table.r, low, m1, m2, m3);
+
+        // 交织成内存中的B G R A，即小端uint32_t的ARGB
+        __m128i bg_lo = _mm_unpacklo_epi8(b, g);
+        __m128i bg_hi = _mm_unpackhi_epi8(b, g);
+        __m128i ra_lo = _mm_unpacklo_epi8(r, alpha);
+        __m128i ra_hi = _mm_unpackhi_epi8(r, alpha);
+        __m128i* dst = reinterpret_cast<__m128i*>(out + i);
+        _mm_storeu_si128(dst, _mm_unpacklo_epi16(bg_lo, ra_lo));
+        _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+        _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+        _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+    }
+    convert_scalar(table, indices + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+inline __m256i lookup_avx2(const uint8_t* plane, __m256i low, __m256i m1, __m256i m2, __m256i m3) {
+    const __m128i* p = reinterpret_cast<const __m128i*>(plane);
+    __m256i v = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(p)), low);
+    v = _mm256_blendv_epi8(v, _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(p + 1)), low), m1);
+    v = _mm256_blendv_epi8(v, _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(p + 2)), low), m2);
+    return _mm256_blendv_epi8(v, _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(p + 3)), low), m3);
+}
+
+__attribute__((target("avx2")))
+void convert_avx2(const Palette::Table& table, const uint8_t* indices, uint32_t* out, size_t count) {
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    const __m256i alpha = _mm256_set1_epi8(static_cast<char>(0xFF));
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+        __m256i low = _mm256_and_si256(index, low_mask);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(index, 4), _mm256_set1_epi8(0x03));
+        __m256i m1 = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(1));
+        __m256i m2 = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(2));
+        __m256i m3 = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(3));
+
+        __m256i b = lookup_avx2(table.b, low, m1, m2, m3);
+        __m256i g = lookup_avx2(table.g, low, m1, m2, m3);
+        __m256i r = lookup_avx2(table.r, low, m1, m2, m3);
+
+        // unpack按128位分两半进行，结果是{0-3,16-19}{4-7,20-23}{8-11,24-27}{12-15,28-31}，再重排成顺序
+        __m256i bg_lo = _mm256_unpacklo_epi8(b, g);
+        __m256i bg_hi = _mm256_unpackhi_epi8(b, g);
+        __m256i ra_lo = _mm256_unpacklo_epi8(r, alpha);
+        __m256i ra_hi = _mm256_unpackhi_epi8(r, alpha);
+        __m256i p0 = _mm256_unpacklo_epi16(bg_lo, ra_lo);
+        __m256i p1 = _mm256_unpackhi_epi16(bg_lo, ra_lo);
+        __m256i p2 = _mm256_unpacklo_epi16(bg_hi, ra_hi);
+        __m256i p3 = _mm256_unpackhi_epi16(bg_hi, ra_hi);
+        __m256i* dst = reinterpret_cast<__m256i*>(out + i);
+        _mm256_storeu_si256(dst, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    convert_scalar(table, indices + i, out + i, count - i);
+}
+
+#endif
+
+bool supported(Palette::KERNEL kernel) {
+#ifdef CNES_PALETTE_X86
+    __builtin_cpu_init();
+    switch (kernel) {
+        case Palette::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case Palette::SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        default:
+            return true;
+    }
+#else
+    return kernel == Palette::SCALAR;
+#endif
+}
+
+Palette::KERNEL detect_kernel() {
+    if (supported(Palette::AVX2)) {
+        return Palette::AVX2;
+    }
+    if (supported(Palette::SSE41)) {
+        return Palette::SSE41;
+    }
+    return Palette::SCALAR;
+}
+
+using ConvertFunction = void (*)(const Palette::Table&, const uint8_t*, uint32_t*, size_t);
+
+ConvertFunction function_for(Palette::KERNEL kernel) {
+    switch (kernel) {
+#ifdef CNES_PALETTE_X86
+        case Palette::AVX2:
+            return convert_avx2;
+        case Palette::SSE41:
+            return convert_sse41;
+#endif
+        default:
+            return convert_scalar;
+    }
+}
+
+Palette::KERNEL g_kernel = detect_kernel();
+ConvertFunction g_convert = function_for(g_kernel);
+
+} // namespace
+
+Palette::Palette() {
+    build(DEFAULT_PALETTE, 64);
+}
+
+bool Palette::load(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> rgb(512 * 3);
+    size_t size = std::fread(rgb.data(), 1, rgb.size(), file);
+    std::fclose(file);
+
+    if (size != 64 * 3 && size != 512 * 3) {
+        return false;
+    }
+    build(rgb.data(), size / 3);
+    return true;
+}
+
+void Palette::build(const uint8_t* rgb, size_t entries) {
+    for (int emphasis = 0; emphasis < 8; emphasis++) {
+        Table& table = tables_[emphasis];
+        for (int index = 0; index < 64; index++) {
+            uint8_t channel[3];
+            if (entries == 512) {
+                for (int c = 0; c < 3; c++) {
+                    channel[c] = rgb[(emphasis * 64 + index) * 3 + c];
+                }
+            }
+            else {
+                // 强调位（红、绿、蓝）让未强调的通道变暗，三位全开时全部变暗；$xE/$xF的黑色不受影响
+                bool black = (index & 0x0F) >= 0x0E;
+                for (int c = 0; c < 3; c++) {
+                    uint8_t value = rgb[index * 3 + c];
+                    bool dim = emphasis && !black && (!(emphasis & (1 << c)) || emphasis == 0x07);
+                    channel[c] = dim ? static_cast<uint8_t>(value * EMPHASIS_ATTENUATION) : value;
+                }
+            }
+            table.r[index] = channel[0];
+            table.g[index] = channel[1];
+            table.b[index] = channel[2];
+            table.argb[index] = 0xFF000000u | (channel[0] << 16) | (channel[1] << 8) | channel[2];
+        }
+    }
+}
+
+void Palette::convert(const uint8_t* screen, const uint8_t* emphasis, uint32_t* out) const {
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        const Table& line = table(emphasis ? emphasis[y] : 0);
+        g_convert(line, screen + y * SCREEN_WIDTH, out + y * SCREEN_WIDTH, SCREEN_WIDTH);
+    }
+}
+
+void Palette::convert_row(const Table& table, const uint8_t* indices, uint32_t* out, size_t count) {
+    g_convert(table, indices, out, count);
+}
+
+Palette::KERNEL Palette::kernel() {
+    return g_kernel;
+}
+
+bool Palette::set_kernel(KERNEL kernel) {
+    if (!supported(kernel)) {
+        return false;
+    }
+    g_kernel = kernel;
+    g_convert = function_for(kernel);
+    return true;
+}
+
+const char* Palette::kernel_name(KERNEL kernel) {
+    switch (kernel) {
+        case AVX2:
+            return "avx2";
+        case SSE41:
+            return "sse4.1";
+        default:
+            return "scalar";
+    }
+}
+
+} // namespace cnes
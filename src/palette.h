@@ -0,0 +1,59 @@
+#ifndef CNES_PALETTE_H
+#define CNES_PALETTE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cnes {
+
+// NES调色板
+// 64种颜色，加上PPUMASK的3个强调位共512项。转换结果为ARGB8888（按uint32_t存放，
+// 对应SDL_PIXELFORMAT_ARGB8888），前端显示、截图和录像共用同一套转换
+class Palette {
+public:
+    // 每组强调位的查找表：ARGB颜色，以及供SIMD字节查表用的B/G/R三个平面
+    struct Table {
+        uint32_t argb[64];
+        uint8_t b[64];
+        uint8_t g[64];
+        uint8_t r[64];
+    };
+
+    // 转换实现，按CPU支持情况自动选择
+    enum KERNEL {
+        SCALAR,
+        SSE41,
+        AVX2
+    };
+
+    // 默认2C02调色板
+    Palette();
+
+    // 读取.pal文件：64项（192字节）时按强调位衰减生成其余项，512项（1536字节）直接使用
+    bool load(const std::string& path);
+
+    const Table& table(uint8_t emphasis) const { return tables_[emphasis & 0x07]; }
+    uint32_t color(uint8_t index, uint8_t emphasis = 0) const { return table(emphasis).argb[index & 0x3F]; }
+
+    // 把一帧颜色索引转换为ARGB，emphasis为每条扫描线的强调位（nullptr表示都为0）
+    void convert(const uint8_t* screen, const uint8_t* emphasis, uint32_t* out) const;
+
+    // 转换一行（count个像素）
+    static void convert_row(const Table& table, const uint8_t* indices, uint32_t* out, size_t count);
+
+    // 当前使用的实现；强制指定不支持的实现时返回false
+    static KERNEL kernel();
+    static bool set_kernel(KERNEL kernel);
+    static const char* kernel_name(KERNEL kernel);
+
+private:
+    Table tables_[8];
+
+    // 由64项基本颜色生成8组强调表
+    void build(const uint8_t* rgb, size_t entries);
+};
+
+} // namespace cnes
+
+#endif // CNES_PALETTE_H
@@ -1,41 +1,656 @@
 #include "ppu.h"
+#include "cartridge.h"
+#include "state.h"
 
+#include <algorithm>
 
 namespace cnes {
   PPU::PPU()
   {
-
+    reset();
   }
 
+  void PPU::connect_cartridge(Cartridge* cartridge)
+  {
+    cartridge_ = cartridge;
+    tiles_dirty_ = true;
+    update_mirroring();
+  }
 
   void PPU::clock()
   {
+    run(1);
+  }
+
+  void PPU::run(uint32_t dots)
+  {
+    while (dots > 0) {
+      // 处理当前点上的事件
+      dot_event();
 
+      // 推进到下一个事件点或行尾，其间的像素一次画完
+      int16_t stop = next_stop();
+      uint32_t step = std::min<uint32_t>(dots, stop - cycle_);
+      render_dots(cycle_, static_cast<int16_t>(cycle_ + step));
+      cycle_ += static_cast<int16_t>(step);
+      dots -= step;
+
+      if (cycle_ >= line_length()) {
+        cycle_ = 0;
+        scanline_++;
+        if (scanline_ > last_scanline_) {
+          scanline_ = PRERENDER_SCANLINE;
+          odd_frame_ = !odd_frame_;
+        }
+      }
+    }
+  }
+
+  int16_t PPU::line_length() const
+  {
+    // NTSC奇数帧且开启渲染时，预渲染行跳过最后一个点
+    if (scanline_ == PRERENDER_SCANLINE && skip_odd_dot_ && odd_frame_ && rendering_enabled()) {
+      return DOTS_PER_SCANLINE - 1;
+    }
+    return DOTS_PER_SCANLINE;
   }
 
+  int16_t PPU::next_stop() const
+  {
+    // 各类扫描线上会发生事件的点，最后一项为行尾
+    static constexpr int16_t RENDER_STOPS[] = {256, 257, MAPPER_CLOCK_DOT, 321, DOTS_PER_SCANLINE};
+    static constexpr int16_t PRERENDER_STOPS[] = {1, 256, 257, MAPPER_CLOCK_DOT, 304, 321, 340, DOTS_PER_SCANLINE};
 
-  void PPU::reset()
+    const int16_t* stops;
+    if (scanline_ == PRERENDER_SCANLINE) {
+      stops = PRERENDER_STOPS;
+    }
+    else if (scanline_ < VISIBLE_SCANLINES) {
+      stops = RENDER_STOPS;
+    }
+    else if (scanline_ == vblank_scanline_ && cycle_ < 1) {
+      return 1;
+    }
+    else {
+      return DOTS_PER_SCANLINE;
+    }
+
+    while (*stops <= cycle_) {
+      stops++;
+    }
+    return *stops;
+  }
+
+  void PPU::dot_event()
+  {
+    if (scanline_ == vblank_scanline_) {
+      if (cycle_ == 1) {
+        enter_vblank();
+      }
+      return;
+    }
+    if (scanline_ >= VISIBLE_SCANLINES) {
+      return;
+    }
+
+    // 预渲染行和可见行
+    switch (cycle_) {
+      case 1:
+        if (scanline_ == PRERENDER_SCANLINE) {
+          leave_vblank();
+        }
+        break;
+      case 256:
+        if (rendering_enabled()) {
+          increment_y();
+        }
+        break;
+      case 257:
+        // 水平位置从t复制回v，同时为下一行准备精灵
+        if (rendering_enabled()) {
+          v_ = (v_ & ~0x041F) | (t_ & 0x041F);
+        }
+        evaluate_sprites();
+        break;
+      case MAPPER_CLOCK_DOT:
+        // 渲染时此处开始取精灵图块，A12上升沿驱动Mapper的扫描线计数
+        if (rendering_enabled() && cartridge_) {
+          cartridge_->scanline();
+        }
+        break;
+      case 304:
+        if (scanline_ == PRERENDER_SCANLINE && rendering_enabled()) {
+          v_ = (v_ & ~0x7BE0) | (t_ & 0x7BE0);
+        }
+        break;
+      case 321:
+        // 下一行从这里开始预取图块
+        line_v_ = v_;
+        line_origin_ = 0;
+        pending_origin_ = -1;
+        break;
+      default:
+        break;
+    }
+  }
+
+  void PPU::increment_y()
+  {
+    if ((v_ & 0x7000) != 0x7000) {
+      v_ += 0x1000;
+      return;
+    }
+
+    v_ &= ~0x7000;
+    uint16_t y = (v_ & 0x03E0) >> 5;
+    if (y == 29) {
+      y = 0;
+      v_ ^= 0x0800;
+    }
+    else if (y == 31) {
+      y = 0;
+    }
+    else {
+      y++;
+    }
+    v_ = (v_ & ~0x03E0) | (y << 5);
+  }
+
+  void PPU::set_vram_address(uint16_t addr)
+  {
+    v_ = addr;
+    if (!rendering_enabled() || scanline_ >= VISIBLE_SCANLINES) {
+      return;
+    }
+
+    if (cycle_ >= 321) {
+      // 下一行的预取已经开始，近似为下一行从头使用新地址
+      line_v_ = v_;
+      line_origin_ = 0;
+      pending_origin_ = -1;
+    }
+    else if (scanline_ >= 0 && cycle_ <= 256) {
+      // 行内写入：新地址从下一组取图块开始使用，
+      // 移位寄存器里还有两个图块，所以在16像素之后才显示出来
+      int16_t slot = cycle_ == 0 ? 2 : (cycle_ - 1) / 8 + 3;
+      pending_v_ = v_;
+      pending_origin_ = slot * 8;
+    }
+  }
+
+  void PPU::render_dots(int16_t from, int16_t to)
+  {
+    if (scanline_ < 0 || scanline_ >= VISIBLE_SCANLINES) {
+      return;
+    }
+
+    // 第1-256点输出第0-255个像素
+    int16_t x0 = std::max<int16_t>(from, 1) - 1;
+    int16_t x1 = std::min<int16_t>(to, 257) - 1;
+    if (x0 >= x1) {
+      return;
+    }
+
+    if (pending_origin_ >= 0) {
+      int16_t start = std::max<int16_t>(pending_origin_ - x_, x0);
+      if (start < x1) {
+        render_span(x0, start);
+        line_v_ = pending_v_;
+        line_origin_ = pending_origin_;
+        pending_origin_ = -1;
+        x0 = start;
+      }
+    }
+    render_span(x0, x1);
+  }
+
+  void PPU::render_span(int16_t x0, int16_t x1)
+  {
+    if (x0 >= x1) {
+      return;
+    }
+
+    // 不输出画面时只有可能发生精灵0命中的行需要逐像素判断
+    if (!output_enabled_ && (!sprite_zero_line_ || (status_ & 0x40) || !rendering_enabled())) {
+      return;
+    }
+
+    uint8_t* out = &screen_[scanline_ * 256];
+    uint8_t grey = (mask_ & 0x01) ? 0x30 : 0x3F;
+    emphasis_[scanline_] = mask_ >> 5;    // 行内修改强调位时按最后一段算
+
+    if (!rendering_enabled()) {
+      std::fill(out + x0, out + x1, palette_[0] & grey);
+      return;
+    }
+    update_tiles();
+
+    // 关闭或裁剪左侧8像素时从对应位置开始显示
+    int16_t bg_start = (mask_ & 0x08) ? ((mask_ & 0x02) ? 0 : 8) : 256;
+    int16_t sprite_start = (mask_ & 0x10) ? ((mask_ & 0x04) ? 0 : 8) : 256;
+
+    uint16_t fine_y = (line_v_ >> 12) & 0x07;
+    uint16_t coarse_y = (line_v_ >> 5) & 0x1F;
+    uint16_t pattern_table = (control_ & 0x10) ? 256 : 0;
+
+    int16_t x = x0;
+    while (x < x1) {
+      // 当前像素所在的图块列，越过32列时切换到相邻名称表
+      int16_t offset = x + x_ - line_origin_;
+      int16_t column = (line_v_ & 0x1F) + (offset >> 3);
+      int16_t px = offset & 0x07;
+      int16_t end = std::min<int16_t>(x1, x + 8 - px);
+
+      uint16_t table = ((line_v_ >> 10) & 0x03) ^ ((column >> 5) & 0x01);
+      column &= 0x1F;
+      const uint8_t* name_table = &name_tables_[name_table_offset_[table]];
+      uint8_t tile = name_table[(coarse_y << 5) | column];
+      uint8_t attribute = name_table[0x3C0 | ((coarse_y >> 2) << 3) | (column >> 2)];
+      uint8_t palette = ((attribute >> (((coarse_y & 0x02) << 1) | (column & 0x02))) & 0x03) << 2;
+      const uint8_t* pixels = &tile_cache_[((pattern_table + tile) * 8 + fine_y) * 8];
+
+      for (; x < end; x++, px++) {
+        uint8_t bg = x >= bg_start ? pixels[px] : 0;
+        uint8_t sprite = x >= sprite_start ? sprite_line_[x] : 0;
+        uint8_t color = bg ? (palette | bg) : 0;
+        if (sprite & 0x03) {
+          if (bg && (sprite & SPRITE_ZERO) && x != 255) {
+            status_ |= 0x40;
+          }
+          if (!bg || !(sprite & SPRITE_BEHIND)) {
+            color = 0x10 | (sprite & 0x0F);
+          }
+        }
+        out[x] = palette_[color] & grey;
+      }
+    }
+  }
+
+  void PPU::evaluate_sprites()
+  {
+    sprite_line_.fill(0);
+    sprite_zero_line_ = false;
+
+    // 在第scanline_行为下一行选出精灵，预渲染行不选
+    if (scanline_ < 0 || scanline_ >= VISIBLE_SCANLINES - 1 || !rendering_enabled()) {
+      return;
+    }
+    update_tiles();
+
+    int16_t height = (control_ & 0x20) ? 16 : 8;
+    int count = 0;
+    for (int i = 0; i < 64; i++) {
+      const uint8_t* sprite = &oam_[i * 4];
+      int16_t row = scanline_ - sprite[0];
+      if (row < 0 || row >= height) {
+        continue;
+      }
+      if (count == 8) {
+        status_ |= 0x20;
+        break;
+      }
+      count++;
+
+      uint8_t attribute = sprite[2];
+      if (attribute & 0x80) {
+        row = height - 1 - row;
+      }
+
+      uint16_t tile;
+      if (height == 16) {
+        tile = ((sprite[1] & 0x01) << 8) | (sprite[1] & 0xFE);
+        if (row >= 8) {
+          tile++;
+          row -= 8;
+        }
+      }
+      else {
+        tile = ((control_ & 0x08) ? 256 : 0) | sprite[1];
+      }
+
+      const uint8_t* pixels = &tile_cache_[(tile * 8 + row) * 8];
+      uint8_t flags = ((attribute & 0x03) << 2)
+                    | ((attribute & 0x20) ? SPRITE_BEHIND : 0)
+                    | (i == 0 ? SPRITE_ZERO : 0);
+
+      // OAM中靠前的精灵优先，已有不透明像素的位置不再覆盖
+      for (int px = 0; px < 8 && sprite[3] + px < 256; px++) {
+        uint8_t value = pixels[(attribute & 0x40) ? 7 - px : px];
+        uint8_t& dest = sprite_line_[sprite[3] + px];
+        if (value && !(dest & 0x03)) {
+          dest = value | flags;
+          sprite_zero_line_ |= i == 0;
+        }
+      }
+    }
+  }
+
+  void PPU::update_tiles()
+  {
+    if (tiles_dirty_) {
+      if (cartridge_ && cartridge_->chr_dirty()) {
+        Mapper::TileMask discard;
+        cartridge_->take_dirty_tiles(discard);
+      }
+      for (uint16_t tile = 0; tile < TILE_COUNT; tile++) {
+        decode_tile(tile);
+      }
+      tiles_dirty_ = false;
+      return;
+    }
+
+    if (!cartridge_ || !cartridge_->chr_dirty()) {
+      return;
+    }
+
+    Mapper::TileMask dirty;
+    cartridge_->take_dirty_tiles(dirty);
+    for (uint16_t word = 0; word < dirty.size(); word++) {
+      uint64_t bits = dirty[word];
+      while (bits) {
+        decode_tile(static_cast<uint16_t>(word * 64 + __builtin_ctzll(bits)));
+        bits &= bits - 1;
+      }
+    }
+  }
+
+  void PPU::decode_tile(uint16_t tile)
+  {
+    // 2bpp平面格式：每个图块16字节，前8字节低位平面，后8字节高位平面
+    for (uint16_t row = 0; row < 8; row++) {
+      uint8_t lo = read(tile * 16 + row);
+      uint8_t hi = read(tile * 16 + row + 8);
+      uint8_t* pixels = &tile_cache_[(tile * 8 + row) * 8];
+      for (int px = 0; px < 8; px++) {
+        pixels[px] = ((lo >> (7 - px)) & 0x01) | (((hi >> (7 - px)) & 0x01) << 1);
+      }
+    }
+  }
+
+  void PPU::update_mirroring()
+  {
+    Cartridge::MIRROR mirror = cartridge_ ? cartridge_->mirror() : Cartridge::HORIZONTAL;
+    switch (mirror) {
+      case Cartridge::VERTICAL:
+        name_table_offset_ = {0x000, 0x400, 0x000, 0x400};
+        break;
+      case Cartridge::ONESCREEN_LO:
+        name_table_offset_ = {0x000, 0x000, 0x000, 0x000};
+        break;
+      case Cartridge::ONESCREEN_HI:
+        name_table_offset_ = {0x400, 0x400, 0x400, 0x400};
+        break;
+      default:
+        name_table_offset_ = {0x000, 0x000, 0x400, 0x400};
+        break;
+    }
+  }
+
+  void PPU::set_region(Region region)
+  {
+    ClockRatio ratio = clock_ratio(region);
+    vblank_scanline_ = ratio.vblank_scanline;
+    last_scanline_ = ratio.last_scanline;
+    skip_odd_dot_ = region == Region::NTSC;
+  }
+
+  uint32_t PPU::dots_until_vblank() const
+  {
+    int32_t frame = (last_scanline_ - PRERENDER_SCANLINE + 1) * DOTS_PER_SCANLINE;
+    int32_t pos = (scanline_ - PRERENDER_SCANLINE) * DOTS_PER_SCANLINE + cycle_;
+    int32_t vblank = (vblank_scanline_ - PRERENDER_SCANLINE) * DOTS_PER_SCANLINE + 1;
+    int32_t dots = (vblank - pos + frame) % frame;
+
+    // 中间经过的预渲染行是否会少一个点（按当前的渲染开关估计，写$2001时总线重新计算）
+    if (skip_odd_dot_ && rendering_enabled()) {
+      if (scanline_ == PRERENDER_SCANLINE && cycle_ < DOTS_PER_SCANLINE - 1) {
+        dots -= odd_frame_ ? 1 : 0;
+      }
+      else if (pos > vblank) {
+        dots -= odd_frame_ ? 0 : 1;
+      }
+    }
+    return static_cast<uint32_t>(dots);
+  }
+
+  uint32_t PPU::dots_until_mapper_clock(uint32_t count) const
+  {
+    if (count == 0) {
+      return 0;
+    }
+
+    // 逐行累加到第count个时钟点，只有预渲染行和可见行会产生时钟
+    uint32_t dots = 0;
+    int16_t scanline = scanline_;
+    int16_t cycle = cycle_;
+    bool odd = odd_frame_;
+    for (;;) {
+      bool counting = scanline == PRERENDER_SCANLINE || scanline < VISIBLE_SCANLINES;
+      if (counting && cycle <= MAPPER_CLOCK_DOT) {
+        if (--count == 0) {
+          return dots + (MAPPER_CLOCK_DOT - cycle);
+        }
+      }
+
+      int16_t length = DOTS_PER_SCANLINE;
+      if (scanline == PRERENDER_SCANLINE && skip_odd_dot_ && odd) {
+        length--;
+      }
+      dots += length - cycle;
+      cycle = 0;
+      if (++scanline > last_scanline_) {
+        scanline = PRERENDER_SCANLINE;
+        odd = !odd;
+      }
+    }
+  }
+
+  void PPU::serialize(StateStream& state)
+  {
+    state(name_tables_);
+    state(palette_);
+    state(oam_);
+    state(sprite_line_);
+    state(control_);
+    state(mask_);
+    state(status_);
+    state(oam_addr_);
+    state(data_buffer_);
+    state(v_);
+    state(t_);
+    state(x_);
+    state(w_);
+    state(line_v_);
+    state(line_origin_);
+    state(pending_v_);
+    state(pending_origin_);
+    state(scanline_);
+    state(cycle_);
+    state(odd_frame_);
+    state(frame_complete_);
+    state(nmi_);
+
+    if (state.loading()) {
+      // 精灵0标记不在存档中，保守地按本行可能命中处理
+      sprite_zero_line_ = true;
+      tiles_dirty_ = true;
+      update_mirroring();
+    }
+  }
+
+  void PPU::enter_vblank()
+  {
+    status_ |= 0x80;
+    frame_complete_ = true;
+    if (control_ & 0x80) {
+      nmi_ = true;
+    }
+  }
+
+  void PPU::leave_vblank()
   {
+    status_ &= ~0xE0;
+  }
+
 
+  void PPU::reset()
+  {
+    control_ = 0x00;
+    mask_ = 0x00;
+    status_ = 0x00;
+    oam_addr_ = 0x00;
+    data_buffer_ = 0x00;
+    v_ = 0x0000;
+    t_ = 0x0000;
+    x_ = 0x00;
+    w_ = false;
+    line_v_ = 0x0000;
+    line_origin_ = 0;
+    pending_origin_ = -1;
+    scanline_ = PRERENDER_SCANLINE;
+    cycle_ = 0;
+    odd_frame_ = false;
+    frame_complete_ = false;
+    nmi_ = false;
+    sprite_line_.fill(0);
+    sprite_zero_line_ = false;
+    tiles_dirty_ = true;
+    update_mirroring();
   }
 
   uint8_t PPU::read_register(uint16_t addr)
   {
+    uint8_t data = 0x00;
+
+    switch (addr) {
+      case 0x2002: // PPUSTATUS，读取后清除vblank标志和写入切换
+        data = (status_ & 0xE0) | (data_buffer_ & 0x1F);
+        status_ &= ~0x80;
+        w_ = false;
+        break;
+      case 0x2004: // OAMDATA
+        data = oam_[oam_addr_];
+        break;
+      case 0x2007: // PPUDATA，调色板直接返回，其余经过读缓冲
+        {
+          uint16_t vram_addr = v_ & 0x3FFF;
+          if (vram_addr >= 0x3F00) {
+            data = read(vram_addr);
+            data_buffer_ = read(vram_addr - 0x1000);
+          }
+          else {
+            data = data_buffer_;
+            data_buffer_ = read(vram_addr);
+          }
+          v_ = (v_ + ((control_ & 0x04) ? 32 : 1)) & 0x7FFF;
+        }
+        break;
+      default:
+        break;
+    }
 
+    return data;
   }
 
   void PPU::write_register(uint16_t addr, uint8_t data)
   {
+    switch (addr) {
+      case 0x2000: // PPUCTRL，vblank期间打开NMI会立即触发
+        if (!(control_ & 0x80) && (data & 0x80) && (status_ & 0x80)) {
+          nmi_ = true;
+        }
+        control_ = data;
+        t_ = (t_ & 0xF3FF) | ((data & 0x03) << 10);
+        break;
+      case 0x2001: // PPUMASK
+        mask_ = data;
+        break;
+      case 0x2003: // OAMADDR
+        oam_addr_ = data;
+        break;
+      case 0x2004: // OAMDATA
+        oam_[oam_addr_++] = data;
+        break;
+      case 0x2005: // PPUSCROLL
+        if (!w_) {
+          x_ = data & 0x07;
+          t_ = (t_ & 0xFFE0) | (data >> 3);
+        }
+        else {
+          t_ = (t_ & 0x8C1F) | ((data & 0x07) << 12) | ((data & 0xF8) << 2);
+        }
+        w_ = !w_;
+        break;
+      case 0x2006: // PPUADDR
+        if (!w_) {
+          t_ = (t_ & 0x80FF) | ((data & 0x3F) << 8);
+        }
+        else {
+          t_ = (t_ & 0xFF00) | data;
+          set_vram_address(t_);
+        }
+        w_ = !w_;
+        break;
+      case 0x2007: // PPUDATA
+        write(v_ & 0x3FFF, data);
+        v_ = (v_ + ((control_ & 0x04) ? 32 : 1)) & 0x7FFF;
+        break;
+      default:
+        break;
+    }
+  }
+
+  uint8_t PPU::read(uint16_t addr)
+  {
+    addr &= 0x3FFF;
+    if (addr < 0x2000) {
+      uint8_t data = 0x00;
+      if (cartridge_) {
+        cartridge_->ppu_read(addr, data);
+      }
+      return data;
+    }
+    if (addr < 0x3F00) {
+      return name_tables_[name_table_offset_[(addr >> 10) & 0x03] + (addr & 0x03FF)];
+    }
 
+    // $3F10/$3F14/$3F18/$3F1C是$3F00/$3F04/$3F08/$3F0C的镜像
+    addr &= 0x1F;
+    if ((addr & 0x13) == 0x10) {
+      addr &= 0x0F;
+    }
+    return palette_[addr];
   }
 
-  bool PPU::frame_complete()
+  void PPU::write(uint16_t addr, uint8_t data)
   {
+    addr &= 0x3FFF;
+    if (addr < 0x2000) {
+      // CHR-RAM写入由Mapper标记脏图块
+      if (cartridge_) {
+        cartridge_->ppu_write(addr, data);
+      }
+      return;
+    }
+    if (addr < 0x3F00) {
+      name_tables_[name_table_offset_[(addr >> 10) & 0x03] + (addr & 0x03FF)] = data;
+      return;
+    }
 
+    addr &= 0x1F;
+    if ((addr & 0x13) == 0x10) {
+      addr &= 0x0F;
+    }
+    palette_[addr] = data & 0x3F;
   }
 
-  void PPU::clear_frame_complete()
+  bool PPU::frame_complete()
   {
+    return frame_complete_;
+  }
 
+  void PPU::clear_frame_complete()
+  {
+    frame_complete_ = false;
   }
 }
@@ -3,12 +3,17 @@
 
 #include <cstdint>
 #include <array>
+#include "scheduler.h"
 
 namespace cnes {
 
 class Bus;
+class Cartridge;
+class StateStream;
 
 // Picture Processing Unit (2C02)
+// 按扫描线片段渲染：两次同步之间的像素用预解码的图块缓存一次画完，
+// 寄存器访问会先把PPU同步到当前点，所以行内修改从对应的像素开始生效
 class PPU {
 public:
     PPU();
@@ -17,9 +22,13 @@ public:
     // PPU与总线连接
     void connect_bus(Bus* bus) { bus_ = bus; }
 
+    // 连接卡带（CHR与名称表镜像）
+    void connect_cartridge(Cartridge* cartridge);
+
     // PPU操作
-    void clock();        // 时钟周期
-    void reset();        // 重置PPU
+    void clock();                // 时钟周期
+    void run(uint32_t dots);     // 批量推进若干个点
+    void reset();                // 重置PPU
 
     // PPU寄存器接口（CPU访问）
     uint8_t read_register(uint16_t addr);
@@ -29,32 +38,126 @@ public:
     bool frame_complete();
     void clear_frame_complete();
 
-    // 屏幕数据
+    // NMI信号（vblank开始且PPUCTRL允许NMI时产生）
+    bool nmi() const { return nmi_; }
+    void clear_nmi() { nmi_ = false; }
+
+    // 帧时序
+    static constexpr int16_t DOTS_PER_SCANLINE = 341;
+    static constexpr int16_t PRERENDER_SCANLINE = -1;
+    static constexpr int16_t VISIBLE_SCANLINES = 240;
+
+    void set_region(Region region);
+
+    // 距离下一个vblank开始点还有多少个点（正好处于该点时为0）
+    uint32_t dots_until_vblank() const;
+
+    // Mapper扫描线计数器的时钟点（精灵图块取数时A12变高）
+    static constexpr int16_t MAPPER_CLOCK_DOT = 260;
+    bool rendering_enabled() const { return (mask_ & 0x18) != 0; }
+
+    // 距离第count个Mapper时钟点还有多少个点（按渲染保持开启估计）
+    uint32_t dots_until_mapper_clock(uint32_t count) const;
+
+    // 卡带镜像模式改变后重新计算名称表偏移
+    void update_mirroring();
+
+    // 屏幕数据（每像素一个6位调色板颜色）
     uint8_t* get_screen() { return screen_.data(); }
 
+    // 每条扫描线的PPUMASK强调位（0-7），与屏幕数据一起交给调色板转换
+    const uint8_t* get_emphasis() const { return emphasis_.data(); }
+
+    // 复制另一台PPU的画面和强调位（画面不在存档中，复制机器时使用）
+    void copy_frame(const PPU& other) {
+        screen_ = other.screen_;
+        emphasis_ = other.emphasis_;
+    }
+
+    // 关闭后不再写屏幕缓冲，只保留影响CPU的精灵0命中判断（预先运行的中间帧用）
+    void set_output(bool enabled) { output_enabled_ = enabled; }
+
+    // 存档（不含屏幕缓冲和图块缓存，读取后图块整体重新解码）
+    void serialize(StateStream& state);
+
 private:
+    // 预解码图块：512个8x8图块，每像素一个0-3的颜色索引
+    static constexpr int TILE_COUNT = 512;
+    std::array<uint8_t, TILE_COUNT * 64> tile_cache_{};
+    bool tiles_dirty_ = true;    // 连接卡带或重置后整体重新解码
+    void update_tiles();         // 重新解码Mapper标记为脏的图块
+    void decode_tile(uint16_t tile);
+
     // PPU内存组件
-    std::array<uint8_t, 2048> pattern_tables_{};    // 图案表
-    std::array<uint8_t, 1024> name_tables_{};       // 名称表
+    std::array<uint8_t, 2048> name_tables_{};       // 名称表（2KB VRAM）
     std::array<uint8_t, 32> palette_{};             // 调色板
     std::array<uint8_t, 256> oam_{};                // 对象属性内存
 
+    // 逻辑名称表到VRAM的偏移，由卡带镜像模式决定
+    std::array<uint16_t, 4> name_table_offset_{};
+
     // 屏幕缓冲
     std::array<uint8_t, 256 * 240> screen_{};
+    std::array<uint8_t, 240> emphasis_{};
+
+    // 下一行的精灵像素：低2位颜色，2-3位调色板，SPRITE_BEHIND/SPRITE_ZERO标志
+    static constexpr uint8_t SPRITE_BEHIND = 0x20;
+    static constexpr uint8_t SPRITE_ZERO = 0x40;
+    std::array<uint8_t, 256> sprite_line_{};
+    bool sprite_zero_line_ = false;    // sprite_line_中有精灵0的像素
+    void evaluate_sprites();
+
+    bool output_enabled_ = true;
 
     // PPU寄存器
     uint8_t control_{};      // 控制寄存器
     uint8_t mask_{};         // 掩码寄存器
     uint8_t status_{};       // 状态寄存器
     uint8_t oam_addr_{};     // OAM地址寄存器
+    uint8_t data_buffer_{};  // $2007读缓冲
+
+    // 内部滚动寄存器
+    uint16_t v_{};           // 当前VRAM地址
+    uint16_t t_{};           // 临时VRAM地址
+    uint8_t x_{};            // 精细X滚动
+    bool w_{};               // $2005/$2006写入切换
+
+    // 本行背景取图块用的地址：line_origin_像素处开始取line_v_指向的图块
+    uint16_t line_v_{};
+    int16_t line_origin_{};
+    // 行内写$2006后的新地址，从pending_origin_处开始取图块（-1表示没有）
+    uint16_t pending_v_{};
+    int16_t pending_origin_ = -1;
 
     // 内部变量
     int16_t scanline_{};     // 当前扫描线
     int16_t cycle_{};        // 当前周期
+    bool odd_frame_{};       // 奇数帧
     bool frame_complete_{};   // 帧完成标志
+    bool nmi_{};             // NMI请求
+
+    // 制式相关的帧结构
+    int16_t vblank_scanline_ = 241;
+    int16_t last_scanline_ = 260;
+    bool skip_odd_dot_ = true;   // NTSC奇数帧预渲染行少一个点
+
+    int16_t line_length() const;
+    int16_t next_stop() const;
+
+    // 时序事件
+    void dot_event();
+    void enter_vblank();
+    void leave_vblank();
+    void increment_y();
+    void set_vram_address(uint16_t addr);
+
+    // 渲染当前行[from, to)点对应的像素
+    void render_dots(int16_t from, int16_t to);
+    void render_span(int16_t x0, int16_t x1);
 
     // 总线指针
     Bus* bus_ = nullptr;
+    Cartridge* cartridge_ = nullptr;
 
     // 内存访问
     uint8_t read(uint16_t addr);
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "machine.h"
+#include "movie.h"
+#include "palette.h"
+
+using namespace cnes;
+
+namespace {
+
+// 把最后一帧按调色板转换后保存为PPM
+bool save_screenshot(Machine& machine, const char* path) {
+    std::vector<uint32_t> pixels(256 * 240);
+    Palette().convert(machine.screen(), machine.emphasis(), pixels.data());
+
+    std::vector<uint8_t> rgb;
+    rgb.reserve(pixels.size() * 3);
+    for (uint32_t pixel : pixels) {
+        rgb.push_back(static_cast<uint8_t>(pixel >> 16));
+        rgb.push_back(static_cast<uint8_t>(pixel >> 8));
+        rgb.push_back(static_cast<uint8_t>(pixel));
+    }
+
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "P6\n256 240\n255\n");
+    bool ok = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+// 无界面全速回放录像，输出最终RAM和画面的散列，用于回归测试和问题复现
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s <rom.nes> <movie.cnm> [--screenshot out.ppm]\n", argv[0]);
+        return 1;
+    }
+    const char* screenshot = argc > 4 && std::strcmp(argv[3], "--screenshot") == 0 ? argv[4] : nullptr;
+
+    std::shared_ptr<const RomImage> rom = RomImage::open(argv[1]);
+    if (!rom) {
+        std::fprintf(stderr, "cannot open ROM: %s\n", argv[1]);
+        return 1;
+    }
+
+    Movie movie;
+    std::string error;
+    Movie::LOAD_RESULT loaded = movie.load_for(argv[2], *rom, &error);
+    if (loaded != Movie::LOADED) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return loaded == Movie::ROM_MISMATCH ? 2 : 1;
+    }
+
+    std::unique_ptr<Machine> machine = Machine::create(rom);
+    if (!machine) {
+        std::fprintf(stderr, "ROM load fail: %s\n", argv[1]);
+        return 1;
+    }
+
+    Bus& bus = machine->bus();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; movie.apply(bus, frame); frame++) {
+        bus.run_frame();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint8_t> ram(0x0800);
+    for (uint16_t addr = 0; addr < ram.size(); addr++) {
+        ram[addr] = bus.peek(addr);
+    }
+
+    std::printf("frames:      %u\n", movie.frame_count());
+    std::printf("wall time:   %.3f s (%.1f frames/second)\n", seconds,
+                seconds > 0.0 ? movie.frame_count() / seconds : 0.0);
+    std::printf("ram hash:    %016llx\n", static_cast<unsigned long long>(fnv1a64(ram.data(), ram.size())));
+    std::printf("frame hash:  %016llx\n",
+                static_cast<unsigned long long>(fnv1a64(machine->screen(), 256 * 240)));
+
+    if (screenshot && !save_screenshot(*machine, screenshot)) {
+        std::fprintf(stderr, "cannot write screenshot: %s\n", screenshot);
+        return 1;
+    }
+    return 0;
+}
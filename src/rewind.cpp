@@ -0,0 +1,206 @@
+#include "rewind.h"
+#include "bus.h"
+
+namespace cnes {
+
+namespace {
+
+// 保留几个缓冲给下一次存档复用
+constexpr size_t FREE_BUFFERS = 4;
+
+void write_varint(std::vector<uint8_t>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+size_t read_varint(const uint8_t*& data) {
+    size_t value = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = *data++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+} // namespace
+
+RewindBuffer::RewindBuffer(Bus& bus, uint32_t interval, size_t budget)
+    : bus_(bus), interval_(interval ? interval : 1), budget_(budget), state_size_(bus.state_size()) {
+    head_.resize(state_size_);
+    bus_.save_state(head_.data(), head_.size());
+    worker_ = std::thread(&RewindBuffer::worker, this);
+}
+
+RewindBuffer::~RewindBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+void RewindBuffer::push() {
+    uint16_t input = static_cast<uint16_t>(bus_.controller(0) | (bus_.controller(1) << 8));
+    frame_++;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    inputs_.push_back(input);
+    if (frame_ % interval_ != 0) {
+        return;
+    }
+
+    std::vector<uint8_t> state;
+    if (!free_.empty()) {
+        state = std::move(free_.back());
+        free_.pop_back();
+    }
+    lock.unlock();
+
+    // 保存新存档，旧存档就地异或成差分交给后台线程压缩
+    state.resize(state_size_);
+    bus_.save_state(state.data(), state.size());
+    for (size_t i = 0; i < state.size(); i++) {
+        head_[i] ^= state[i];
+    }
+    Delta delta{head_frame_, frame_, std::move(head_)};
+    head_ = std::move(state);
+    head_frame_ = frame_;
+
+    lock.lock();
+    pending_.push_back(std::move(delta));
+    lock.unlock();
+    cv_.notify_all();
+}
+
+bool RewindBuffer::seek(uint64_t frame) {
+    flush();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame > frame_ || frame < oldest_frame_) {
+        return false;
+    }
+
+    // 从不晚于frame - 1的存档开始，至少重新运行一帧，让屏幕缓冲与该帧一致
+    uint64_t base = frame > oldest_frame_ ? frame - 1 : frame;
+    while (head_frame_ > base) {
+        Delta& delta = deltas_.back();
+        apply(delta.data, head_);
+        head_frame_ = delta.frame;
+        delta_bytes_ -= delta.data.size();
+        deltas_.pop_back();
+    }
+    if (!bus_.load_state(head_.data(), head_.size())) {
+        return false;
+    }
+
+    for (uint64_t f = head_frame_; f < frame; f++) {
+        uint16_t input = inputs_[f - oldest_frame_];
+        bus_.set_controller(0, input & 0xFF);
+        bus_.set_controller(1, input >> 8);
+        bus_.run_frame();
+    }
+
+    inputs_.resize(frame - oldest_frame_);
+    frame_ = frame;
+    return true;
+}
+
+uint64_t RewindBuffer::oldest_frame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return oldest_frame_;
+}
+
+size_t RewindBuffer::memory_used() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return delta_bytes_ + state_size_ + inputs_.size() * sizeof(uint16_t);
+}
+
+void RewindBuffer::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_.empty() && !busy_; });
+}
+
+void RewindBuffer::worker() {
+    std::vector<uint8_t> encoded;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+        if (pending_.empty()) {
+            return;
+        }
+
+        Delta job = std::move(pending_.front());
+        pending_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        // 压缩后按实际大小复制一份，避免每份差分都占着存档大小的容量
+        encode(job.data, encoded);
+        Delta delta{job.frame, job.next_frame, std::vector<uint8_t>(encoded.begin(), encoded.end())};
+
+        lock.lock();
+        delta_bytes_ += delta.data.size();
+        deltas_.push_back(std::move(delta));
+        if (free_.size() < FREE_BUFFERS) {
+            free_.push_back(std::move(job.data));
+        }
+        trim();
+        busy_ = false;
+        cv_.notify_all();
+    }
+}
+
+void RewindBuffer::trim() {
+    while (!deltas_.empty() && delta_bytes_ + state_size_ + inputs_.size() * sizeof(uint16_t) > budget_) {
+        const Delta& oldest = deltas_.front();
+        inputs_.erase(inputs_.begin(), inputs_.begin() + (oldest.next_frame - oldest.frame));
+        oldest_frame_ = oldest.next_frame;
+        delta_bytes_ -= oldest.data.size();
+        deltas_.pop_front();
+    }
+}
+
+void RewindBuffer::encode(const std::vector<uint8_t>& xor_data, std::vector<uint8_t>& out) {
+    out.clear();
+    size_t size = xor_data.size();
+    size_t i = 0;
+    while (i < size) {
+        size_t zeros = i;
+        while (zeros < size && xor_data[zeros] == 0) {
+            zeros++;
+        }
+        if (zeros == size) {
+            break;    // 末尾的0不编码
+        }
+        size_t end = zeros;
+        while (end < size && xor_data[end] != 0) {
+            end++;
+        }
+        write_varint(out, zeros - i);
+        write_varint(out, end - zeros);
+        out.insert(out.end(), xor_data.begin() + zeros, xor_data.begin() + end);
+        i = end;
+    }
+}
+
+void RewindBuffer::apply(const std::vector<uint8_t>& delta, std::vector<uint8_t>& state) {
+    const uint8_t* data = delta.data();
+    const uint8_t* end = data + delta.size();
+    size_t pos = 0;
+    while (data < end) {
+        pos += read_varint(data);
+        size_t count = read_varint(data);
+        for (size_t i = 0; i < count; i++) {
+            state[pos++] ^= *data++;
+        }
+    }
+}
+
+} // namespace cnes
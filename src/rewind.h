@@ -0,0 +1,87 @@
+#ifndef CNES_REWIND_H
+#define CNES_REWIND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cnes {
+
+class Bus;
+
+// 倒带缓冲
+// 每interval帧保存一次存档，只完整保留最新的一份；更早的存档以相邻两份的XOR差分保存，
+// 差分在后台线程做游程压缩（相邻帧之间大部分字节不变，差分几乎全是0）。
+// 超出内存预算时丢弃最旧的差分。回退时从最新存档依次异或回去，
+// 再用记录的输入把中间的帧重新运行一遍，所以可以精确回到任意一帧
+class RewindBuffer {
+public:
+    RewindBuffer(Bus& bus, uint32_t interval = 1, size_t budget = 8 * 1024 * 1024);
+    ~RewindBuffer();
+
+    RewindBuffer(const RewindBuffer&) = delete;
+    RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+    // 每运行完一帧调用一次：记录这一帧的手柄输入，按间隔保存存档
+    void push();
+
+    // 回到第frame帧结束时的状态，之后的历史被丢弃；超出可回退范围时返回false
+    bool seek(uint64_t frame);
+    bool rewind(uint32_t frames) { return frames <= frame_ && seek(frame_ - frames); }
+
+    // 当前帧号（构造时为0）和可以回到的最早帧
+    uint64_t frame() const { return frame_; }
+    uint64_t oldest_frame();
+
+    // 差分、最新存档和输入记录占用的字节数
+    size_t memory_used();
+
+    // 等待后台线程压缩完已提交的差分
+    void flush();
+
+private:
+    // 一份差分：与前一份存档的XOR，编码为若干组 [0的个数][非0字节数][字节]，长度用变长整数
+    struct Delta {
+        uint64_t frame;        // 解开后得到的存档帧号
+        uint64_t next_frame;   // 与之异或的后一份存档帧号
+        std::vector<uint8_t> data;
+    };
+
+    Bus& bus_;
+    uint32_t interval_;
+    size_t budget_;
+    size_t state_size_;
+
+    uint64_t frame_ = 0;
+    std::vector<uint8_t> head_;         // 最新存档
+    uint64_t head_frame_ = 0;
+
+    // 以下由mutex_保护，后台线程会追加差分并按预算丢弃最旧的记录
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Delta> deltas_;          // 从旧到新
+    std::deque<uint16_t> inputs_;       // oldest_frame_起每帧的输入（低8位手柄1，高8位手柄2）
+    uint64_t oldest_frame_ = 0;
+    size_t delta_bytes_ = 0;
+
+    // 待压缩的XOR差分，和压缩完后回收复用的缓冲
+    std::deque<Delta> pending_;
+    std::vector<std::vector<uint8_t>> free_;
+    bool busy_ = false;
+    bool stop_ = false;
+    std::thread worker_;
+
+    void worker();
+    void trim();
+
+    static void encode(const std::vector<uint8_t>& xor_data, std::vector<uint8_t>& out);
+    static void apply(const std::vector<uint8_t>& delta, std::vector<uint8_t>& state);
+};
+
+} // namespace cnes
+
+#endif // CNES_REWIND_H
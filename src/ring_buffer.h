@@ -0,0 +1,67 @@
+#ifndef CNES_RING_BUFFER_H
+#define CNES_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace cnes {
+
+// 单写单读的无锁环形缓冲（音频采样交给声卡回调用）
+// 读写位置各自只由一方修改，另一方只读取，双方都不会等待；容量取2的幂
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        buffer_.resize(size);
+        mask_ = size - 1;
+    }
+
+    // 写端：写入最多count个，缓冲满时丢弃其余，返回实际个数
+    size_t push(const T* data, size_t count) {
+        size_t write = write_.load(std::memory_order_relaxed);
+        size_t read = read_.load(std::memory_order_acquire);
+        size_t free = buffer_.size() - (write - read);
+        if (count > free) {
+            count = free;
+        }
+        for (size_t i = 0; i < count; i++) {
+            buffer_[(write + i) & mask_] = data[i];
+        }
+        write_.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    // 读端：读出最多count个，返回实际个数
+    size_t pop(T* data, size_t count) {
+        size_t read = read_.load(std::memory_order_relaxed);
+        size_t write = write_.load(std::memory_order_acquire);
+        if (count > write - read) {
+            count = write - read;
+        }
+        for (size_t i = 0; i < count; i++) {
+            data[i] = buffer_[(read + i) & mask_];
+        }
+        read_.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    // 当前可读的个数（只作估计，另一方可能同时在修改）
+    size_t size() const {
+        return write_.load(std::memory_order_acquire) - read_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> write_{0};
+    alignas(64) std::atomic<size_t> read_{0};
+};
+
+} // namespace cnes
+
+#endif // CNES_RING_BUFFER_H
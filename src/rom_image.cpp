@@ -0,0 +1,120 @@
+#include "rom_image.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cnes {
+
+namespace {
+
+// 进程内已打开的映像，按文件身份（设备、inode、修改时间、大小）索引
+// 只保存weak_ptr，最后一个卡带释放后映像随之解除映射
+std::mutex g_cache_mutex;
+std::unordered_map<std::string, std::weak_ptr<const RomImage>> g_cache;
+
+} // namespace
+
+RomImage::~RomImage() {
+#ifndef _WIN32
+    if (mapping_) {
+        munmap(mapping_, size_);
+    }
+#endif
+}
+
+std::shared_ptr<const RomImage> RomImage::from_memory(std::vector<uint8_t> data) {
+    std::shared_ptr<RomImage> image(new RomImage());
+    image->owned_ = std::move(data);
+    image->data_ = image->owned_.data();
+    image->size_ = image->owned_.size();
+    return image;
+}
+
+#ifdef _WIN32
+
+std::shared_ptr<const RomImage> RomImage::open(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return nullptr;
+    }
+    return from_memory(std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                            std::istreambuf_iterator<char>()));
+}
+
+#else
+
+std::shared_ptr<const RomImage> RomImage::open(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    // 管道等无法映射的文件直接读入内存
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        std::vector<uint8_t> data;
+        uint8_t buffer[16384];
+        ssize_t count;
+        while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+            data.insert(data.end(), buffer, buffer + count);
+        }
+        close(fd);
+        return count < 0 ? nullptr : from_memory(std::move(data));
+    }
+
+    std::string key = std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":" +
+                      std::to_string(st.st_mtime) + ":" + std::to_string(st.st_size);
+
+    std::lock_guard<std::mutex> lock(g_cache_mutex);
+    auto it = g_cache.find(key);
+    if (it != g_cache.end()) {
+        if (std::shared_ptr<const RomImage> image = it->second.lock()) {
+            close(fd);
+            return image;
+        }
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::shared_ptr<RomImage> image(new RomImage());
+    image->mapping_ = mapping;
+    image->data_ = static_cast<const uint8_t*>(mapping);
+    image->size_ = size;
+
+    // 顺便清理已经释放的映像
+    for (auto entry = g_cache.begin(); entry != g_cache.end();) {
+        entry = entry->second.expired() ? g_cache.erase(entry) : std::next(entry);
+    }
+    g_cache[key] = image;
+    return image;
+}
+
+#endif
+
+RomSpan RomImage::span(size_t offset, size_t size) const {
+    if (offset > size_ || size > size_ - offset) {
+        return {};
+    }
+    return {data_ + offset, size};
+}
+
+} // namespace cnes
@@ -0,0 +1,54 @@
+#ifndef CNES_ROM_IMAGE_H
+#define CNES_ROM_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cnes {
+
+// ROM映像中的一段只读数据（不持有内存）
+struct RomSpan {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    bool empty() const { return size == 0; }
+    const uint8_t& operator[](size_t index) const { return data[index]; }
+};
+
+// 不可变的ROM文件映像
+// 文件以只读方式mmap，同一进程内同一个文件只映射一次，各卡带通过shared_ptr共享
+class RomImage {
+public:
+    ~RomImage();
+
+    RomImage(const RomImage&) = delete;
+    RomImage& operator=(const RomImage&) = delete;
+
+    // 打开ROM文件，文件已被映射时直接共享；失败返回nullptr
+    static std::shared_ptr<const RomImage> open(const std::string& filename);
+
+    // 用内存数据创建映像（数据移入映像，不复制）
+    static std::shared_ptr<const RomImage> from_memory(std::vector<uint8_t> data);
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // 取[offset, offset + size)，超出范围时返回空
+    RomSpan span(size_t offset, size_t size) const;
+
+private:
+    RomImage() = default;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    void* mapping_ = nullptr;       // mmap区域，为空时数据在owned_中
+    std::vector<uint8_t> owned_;
+};
+
+} // namespace cnes
+
+#endif // CNES_ROM_IMAGE_H
@@ -0,0 +1,35 @@
+#include "runahead.h"
+#include "machine.h"
+
+namespace cnes {
+
+RunAhead::RunAhead(Machine& machine, uint32_t frames)
+    : machine_(machine), frames_(frames), state_(machine.bus().state_size()) {
+}
+
+void RunAhead::run_frame() {
+    if (frames_ == 0) {
+        machine_.run_frame();
+        return;
+    }
+
+    Bus& bus = machine_.bus();
+    PPU& ppu = machine_.ppu();
+
+    // 声音只取真实的那一帧，画面只取最后一帧
+    ppu.set_output(false);
+    bus.run_frame();
+    bus.save_state(state_.data(), state_.size());
+
+    bus.set_audio_output(false);
+    for (uint32_t i = 1; i < frames_; i++) {
+        bus.run_frame();
+    }
+    ppu.set_output(true);
+    bus.run_frame();
+
+    bus.load_state(state_.data(), state_.size());
+    bus.set_audio_output(true);
+}
+
+} // namespace cnes
@@ -0,0 +1,33 @@
+#ifndef CNES_RUNAHEAD_H
+#define CNES_RUNAHEAD_H
+
+#include <cstdint>
+#include <vector>
+
+namespace cnes {
+
+class Machine;
+
+// 预先运行
+// 每个主机帧先不输出画面地运行一帧（真实进度）并存档，再按当前输入多运行frames帧，
+// 只输出最后一帧的画面，然后读回存档。游戏对输入的反应因此提前frames帧出现在屏幕上，
+// 代价是每个主机帧多模拟frames帧
+class RunAhead {
+public:
+    RunAhead(Machine& machine, uint32_t frames);
+
+    // frames为0时等同于Machine::run_frame()
+    void set_frames(uint32_t frames) { frames_ = frames; }
+    uint32_t frames() const { return frames_; }
+
+    void run_frame();
+
+private:
+    Machine& machine_;
+    uint32_t frames_;
+    std::vector<uint8_t> state_;
+};
+
+} // namespace cnes
+
+#endif // CNES_RUNAHEAD_H
@@ -0,0 +1,59 @@
+#include "scheduler.h"
+#include "state.h"
+
+namespace cnes {
+
+void Scheduler::reset() {
+    deadlines_.fill(NEVER);
+    next_deadline_ = NEVER;
+}
+
+void Scheduler::schedule(EVENT event, uint64_t timestamp) {
+    deadlines_[event] = timestamp;
+    if (timestamp < next_deadline_) {
+        next_deadline_ = timestamp;
+    }
+    else {
+        update_next_deadline();
+    }
+}
+
+void Scheduler::cancel(EVENT event) {
+    deadlines_[event] = NEVER;
+    update_next_deadline();
+}
+
+bool Scheduler::pop_due(uint64_t timestamp, EVENT& event, uint64_t& deadline) {
+    if (next_deadline_ >= timestamp) {
+        return false;
+    }
+
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        if (deadlines_[i] == next_deadline_) {
+            event = static_cast<EVENT>(i);
+            deadline = next_deadline_;
+            deadlines_[i] = NEVER;
+            update_next_deadline();
+            return true;
+        }
+    }
+    return false;
+}
+
+void Scheduler::serialize(StateStream& state) {
+    state(deadlines_);
+    if (state.loading()) {
+        update_next_deadline();
+    }
+}
+
+void Scheduler::update_next_deadline() {
+    next_deadline_ = NEVER;
+    for (uint64_t deadline : deadlines_) {
+        if (deadline < next_deadline_) {
+            next_deadline_ = deadline;
+        }
+    }
+}
+
+} // namespace cnes
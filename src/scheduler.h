@@ -0,0 +1,81 @@
+#ifndef CNES_SCHEDULER_H
+#define CNES_SCHEDULER_H
+
+#include <cstdint>
+#include <array>
+
+namespace cnes {
+
+class StateStream;
+
+// 电视制式
+enum class Region {
+    NTSC,
+    PAL,
+    DENDY
+};
+
+// 主时钟分频比：各组件每个周期对应的主时钟数
+struct ClockRatio {
+    uint8_t cpu_divider;      // CPU周期
+    uint8_t ppu_divider;      // PPU点
+    int16_t vblank_scanline;  // vblank开始的扫描线
+    int16_t last_scanline;    // 每帧最后一条扫描线
+};
+
+// 按制式取分频比
+constexpr ClockRatio clock_ratio(Region region) {
+    switch (region) {
+        case Region::PAL:   return {16, 5, 241, 310};
+        case Region::DENDY: return {15, 5, 291, 310};
+        default:            return {12, 4, 241, 260};
+    }
+}
+
+// 按制式取帧率（前端按此限速）
+constexpr double frame_rate(Region region) {
+    return region == Region::NTSC ? 60.0988 : 50.0070;
+}
+
+// 基于64位主时钟时间戳的事件调度器
+// 各组件登记自己下一个会影响CPU的事件，CPU自由运行到最早的截止时间
+class Scheduler {
+public:
+    enum EVENT {
+        PPU_VBLANK,   // vblank开始（NMI、帧完成）
+        DMA_DONE,     // OAM DMA结束，CPU恢复运行
+        MAPPER_IRQ,   // Mapper扫描线计数器触发IRQ
+        APU_FRAME,    // APU帧计数器或DMC置IRQ
+        EVENT_COUNT
+    };
+
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    Scheduler() { reset(); }
+
+    void reset();
+
+    // 登记/取消事件
+    void schedule(EVENT event, uint64_t timestamp);
+    void cancel(EVENT event);
+
+    // 最早的截止时间
+    uint64_t next_deadline() const { return next_deadline_; }
+    uint64_t deadline(EVENT event) const { return deadlines_[event]; }
+
+    // 取出截止时间早于timestamp的最早事件
+    bool pop_due(uint64_t timestamp, EVENT& event, uint64_t& deadline);
+
+    // 存档
+    void serialize(StateStream& state);
+
+private:
+    std::array<uint64_t, EVENT_COUNT> deadlines_{};
+    uint64_t next_deadline_ = NEVER;
+
+    void update_next_deadline();
+};
+
+} // namespace cnes
+
+#endif // CNES_SCHEDULER_H
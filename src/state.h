@@ -0,0 +1,77 @@
+#ifndef CNES_STATE_H
+#define CNES_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace cnes {
+
+// 存档流
+// 各组件实现 serialize(StateStream&)，按固定顺序把每个字段交给流一次，
+// 同一份代码用于计算大小、保存和读取。字段按本机字节序原样拷贝，不分配内存
+class StateStream {
+public:
+    enum MODE {
+        MEASURE,   // 只累计大小
+        SAVE,
+        LOAD
+    };
+
+    // 计算大小
+    StateStream() : mode_(MEASURE) { }
+
+    // 保存到data
+    StateStream(uint8_t* data, size_t size) : mode_(SAVE), data_(data), size_(size) { }
+
+    // 从data读取
+    StateStream(const uint8_t* data, size_t size)
+        : mode_(LOAD), data_(const_cast<uint8_t*>(data)), size_(size) { }
+
+    bool loading() const { return mode_ == LOAD; }
+    size_t position() const { return position_; }
+
+    // 是否有越界访问（越界部分不会读写）
+    bool ok() const { return !overflow_; }
+
+    // 定长字段（整数、布尔、std::array、简单结构体）
+    template <typename T>
+    void operator()(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "state field must be trivially copyable");
+        bytes(&value, sizeof(T));
+    }
+
+    // 长度由ROM决定的RAM，长度本身不保存
+    void operator()(std::vector<uint8_t>& values) {
+        bytes(values.data(), values.size());
+    }
+
+    void bytes(void* value, size_t size) {
+        if (mode_ != MEASURE) {
+            if (position_ + size > size_) {
+                overflow_ = true;
+                return;
+            }
+            if (mode_ == SAVE) {
+                std::memcpy(data_ + position_, value, size);
+            }
+            else {
+                std::memcpy(value, data_ + position_, size);
+            }
+        }
+        position_ += size;
+    }
+
+private:
+    MODE mode_;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t position_ = 0;
+    bool overflow_ = false;
+};
+
+} // namespace cnes
+
+#endif // CNES_STATE_H
@@ -20,7 +20,7 @@ public:
             0x00,                     // PRG-RAM大小
             0x00,                     // NTSC格式
             0x00,                     // 未使用
-            0x00, 0x00, 0x00, 0x00   // 未使用
+            0x00, 0x00, 0x00, 0x00, 0x00   // 未使用
         };
 
         // PRG-ROM (16KB)
@@ -0,0 +1,126 @@
+#include "trace.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+namespace cnes {
+
+namespace {
+
+// 跟踪文件头
+struct TraceFileHeader {
+    char magic[8];          // "CNESTRC\0"
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+};
+
+constexpr char TRACE_MAGIC[8] = {'C', 'N', 'E', 'S', 'T', 'R', 'C', '\0'};
+constexpr uint32_t TRACE_VERSION = 1;
+
+// 写完size字节，被信号打断时重试
+bool write_all(int fd, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+TraceBuffer::TraceBuffer(uint32_t capacity_log2)
+    : records_(static_cast<size_t>(1) << capacity_log2),
+      mask_((static_cast<uint64_t>(1) << capacity_log2) - 1) {
+}
+
+bool TraceBuffer::save(const std::string& filename) const {
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    TraceFileHeader header{};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.count = size();
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+    // 缓冲区已绕回时，最旧的记录从head_处开始
+    uint64_t start = head_ - header.count;
+    uint64_t first = start & mask_;
+    uint64_t first_count = records_.size() - first;
+    if (first_count > header.count) {
+        first_count = header.count;
+    }
+
+    ok = ok && std::fwrite(&records_[first], sizeof(TraceRecord), first_count, file) == first_count;
+    uint64_t rest = header.count - first_count;
+    ok = ok && std::fwrite(records_.data(), sizeof(TraceRecord), rest, file) == rest;
+
+    return std::fclose(file) == 0 && ok;
+}
+
+bool TraceBuffer::save_raw(int fd) const {
+    // 不分配内存、不经过stdio，崩溃发生在malloc或stdio内部时也能写出
+    TraceFileHeader header{};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.count = size();
+
+    uint64_t start = head_ - header.count;
+    uint64_t first = start & mask_;
+    uint64_t first_count = records_.size() - first;
+    if (first_count > header.count) {
+        first_count = header.count;
+    }
+    uint64_t rest = header.count - first_count;
+
+    return write_all(fd, &header, sizeof(header)) &&
+           write_all(fd, &records_[first], first_count * sizeof(TraceRecord)) &&
+           write_all(fd, records_.data(), rest * sizeof(TraceRecord));
+}
+
+bool TraceBuffer::load(const std::string& filename, std::vector<TraceRecord>& records) {
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    TraceFileHeader header{};
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+        && std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == TRACE_VERSION
+        && header.record_size == sizeof(TraceRecord);
+
+    // 记录数先与文件大小核对，损坏的文件头不会导致分配过大的内存
+    if (ok) {
+        long position = std::ftell(file);
+        ok = position >= 0 && std::fseek(file, 0, SEEK_END) == 0;
+        long end = ok ? std::ftell(file) : -1;
+        ok = ok && end >= position && std::fseek(file, position, SEEK_SET) == 0
+            && header.count == static_cast<uint64_t>(end - position) / sizeof(TraceRecord);
+    }
+
+    if (ok) {
+        records.resize(header.count);
+        ok = std::fread(records.data(), sizeof(TraceRecord), header.count, file) == header.count;
+    }
+
+    std::fclose(file);
+    return ok;
+}
+
+} // namespace cnes
@@ -0,0 +1,63 @@
+#ifndef CNES_TRACE_H
+#define CNES_TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cnes {
+
+// 一条指令的跟踪记录（执行前的状态），固定16字节
+struct TraceRecord {
+    uint16_t pc;            // 指令地址
+    uint8_t opcode;         // 操作码
+    uint8_t operand[2];     // 后续两个字节（按指令长度取用）
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t p;
+    uint8_t sp;
+    uint16_t cycle_hi;      // CPU周期计数高16位
+    uint32_t cycle_lo;      // CPU周期计数低32位
+
+    uint64_t cycle() const { return (static_cast<uint64_t>(cycle_hi) << 32) | cycle_lo; }
+};
+
+static_assert(sizeof(TraceRecord) == 16, "trace record must stay 16 bytes");
+
+// 固定大小的内存环形缓冲区，保存最近的指令记录
+class TraceBuffer {
+public:
+    // 容量为2^capacity_log2条记录
+    explicit TraceBuffer(uint32_t capacity_log2 = 20);
+
+    // 热路径：每条指令一次写入
+    void record(const TraceRecord& record) {
+        records_[head_ & mask_] = record;
+        head_++;
+    }
+
+    void clear() { head_ = 0; }
+
+    // 缓冲区中的记录数与累计记录数
+    uint64_t size() const { return head_ < records_.size() ? head_ : records_.size(); }
+    uint64_t total() const { return head_; }
+
+    // 按时间顺序写入二进制文件
+    bool save(const std::string& filename) const;
+
+    // 同样的内容写入已打开的文件，只调用write(2)，可在信号处理函数中使用
+    bool save_raw(int fd) const;
+
+    // 读取save()写出的文件
+    static bool load(const std::string& filename, std::vector<TraceRecord>& records);
+
+private:
+    std::vector<TraceRecord> records_;
+    uint64_t mask_;
+    uint64_t head_ = 0;
+};
+
+} // namespace cnes
+
+#endif // CNES_TRACE_H
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <vector>
+#include "cpu.h"
+#include "trace.h"
+
+using namespace cnes;
+
+namespace {
+
+// 各寻址模式的指令长度
+int instruction_length(CPU::ADDR_MODE mode) {
+    switch (mode) {
+        case CPU::IMP:
+        case CPU::ACC:
+            return 1;
+        case CPU::ABS:
+        case CPU::ABX:
+        case CPU::ABY:
+        case CPU::IND:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+// 反汇编操作数
+void format_operand(const TraceRecord& r, CPU::ADDR_MODE mode, char* out, size_t size) {
+    uint8_t lo = r.operand[0];
+    uint16_t abs = static_cast<uint16_t>(r.operand[1] << 8 | lo);
+
+    switch (mode) {
+        case CPU::IMP: out[0] = '\0'; break;
+        case CPU::ACC: std::snprintf(out, size, "A"); break;
+        case CPU::IMM: std::snprintf(out, size, "#$%02X", lo); break;
+        case CPU::ZP0: std::snprintf(out, size, "$%02X", lo); break;
+        case CPU::ZPX: std::snprintf(out, size, "$%02X,X", lo); break;
+        case CPU::ZPY: std::snprintf(out, size, "$%02X,Y", lo); break;
+        case CPU::REL:
+            std::snprintf(out, size, "$%04X", static_cast<uint16_t>(r.pc + 2 + static_cast<int8_t>(lo)));
+            break;
+        case CPU::ABS: std::snprintf(out, size, "$%04X", abs); break;
+        case CPU::ABX: std::snprintf(out, size, "$%04X,X", abs); break;
+        case CPU::ABY: std::snprintf(out, size, "$%04X,Y", abs); break;
+        case CPU::IND: std::snprintf(out, size, "($%04X)", abs); break;
+        case CPU::IZX: std::snprintf(out, size, "($%02X,X)", lo); break;
+        case CPU::IZY: std::snprintf(out, size, "($%02X),Y", lo); break;
+    }
+}
+
+// 输出一行nestest格式的日志（不含PPU列）
+void print_record(std::FILE* out, const TraceRecord& r) {
+    CPU::OpcodeInfo info = CPU::opcode_info(r.opcode);
+    int length = instruction_length(info.mode);
+
+    char bytes[16];
+    if (length == 1) {
+        std::snprintf(bytes, sizeof(bytes), "%02X", r.opcode);
+    }
+    else if (length == 2) {
+        std::snprintf(bytes, sizeof(bytes), "%02X %02X", r.opcode, r.operand[0]);
+    }
+    else {
+        std::snprintf(bytes, sizeof(bytes), "%02X %02X %02X", r.opcode, r.operand[0], r.operand[1]);
+    }
+
+    char operand[16];
+    format_operand(r, info.mode, operand, sizeof(operand));
+
+    char disasm[40];
+    std::snprintf(disasm, sizeof(disasm), "%s%s%s", info.name, operand[0] ? " " : "", operand);
+
+    std::fprintf(out, "%04X  %-8s %c%-31s A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu\n",
+                 r.pc, bytes, info.official ? ' ' : '*', disasm,
+                 r.a, r.x, r.y, r.p, r.sp, static_cast<unsigned long long>(r.cycle()));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <trace.bin> [out.txt]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<TraceRecord> records;
+    if (!TraceBuffer::load(argv[1], records)) {
+        std::fprintf(stderr, "invalid trace file: %s\n", argv[1]);
+        return 1;
+    }
+
+    std::FILE* out = stdout;
+    if (argc > 2) {
+        out = std::fopen(argv[2], "w");
+        if (!out) {
+            std::fprintf(stderr, "cannot open output: %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    for (const TraceRecord& record : records) {
+        print_record(out, record);
+    }
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef CNES_TRIPLE_BUFFER_H
+#define CNES_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace cnes {
+
+// 单写单读的无锁三缓冲
+// 写端和读端各占一个槽，第三个槽用于交换；交换只是一次原子exchange，双方都不会等待。
+// 读端总是拿到最新写完的一份，写得比读快时中间的帧被丢弃
+template <typename T>
+class TripleBuffer {
+public:
+    // 写端：填写back()，然后publish()
+    T& back() { return slots_[back_]; }
+    void publish() {
+        back_ = middle_.exchange(static_cast<uint8_t>(back_ | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    // 读端：update()在有新数据时换到最新一份并返回true，front()在下次update()前保持不变
+    bool update() {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x03;
+    static constexpr uint8_t FRESH = 0x04;    // 中间槽中是读端还没取走的新数据
+
+    T slots_[3]{};
+    uint8_t back_ = 0;                        // 只由写端访问
+    uint8_t front_ = 1;                       // 只由读端访问
+    alignas(64) std::atomic<uint8_t> middle_{2};
+};
+
+} // namespace cnes
+
+#endif // CNES_TRIPLE_BUFFER_H
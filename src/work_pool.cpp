@@ -0,0 +1,100 @@
+#include "work_pool.h"
+
+namespace cnes {
+
+WorkPool::WorkPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        threads_.emplace_back(&WorkPool::worker, this, i);
+    }
+}
+
+WorkPool::~WorkPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkPool::submit(std::function<void()> task) {
+    Queue& queue = *queues_[next_queue_];
+    next_queue_ = (next_queue_ + 1) % queues_.size();
+
+    // 先计数再入队，取走任务的线程不会把计数减到0以下
+    pending_++;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    work_cv_.notify_one();
+}
+
+void WorkPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+bool WorkPool::take(unsigned index, std::function<void()>& task) {
+    // 先取自己队列的队尾
+    {
+        Queue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // 再从其他队列的队首窃取
+    for (size_t i = 1; i < queues_.size(); i++) {
+        Queue& victim = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkPool::worker(unsigned index) {
+    for (;;) {
+        std::function<void()> task;
+        if (take(index, task)) {
+            queued_--;
+            task();
+            if (--pending_ == 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                done_cv_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_cv_.wait(lock, [this] { return stop_ || queued_ > 0; });
+        if (stop_ && queued_ == 0) {
+            return;
+        }
+    }
+}
+
+} // namespace cnes
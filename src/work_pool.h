@@ -0,0 +1,59 @@
+#ifndef CNES_WORK_POOL_H
+#define CNES_WORK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cnes {
+
+// 工作窃取线程池
+// 每个工作线程有自己的任务队列，从队尾取自己的任务；自己的队列空了就从其他队列的队首窃取，
+// 长短不一的任务因此能均匀地占满所有核心
+class WorkPool {
+public:
+    // threads为0时使用硬件线程数
+    explicit WorkPool(unsigned threads = 0);
+    ~WorkPool();
+
+    WorkPool(const WorkPool&) = delete;
+    WorkPool& operator=(const WorkPool&) = delete;
+
+    // 提交任务，依次分配到各线程的队列
+    void submit(std::function<void()> task);
+
+    // 等待已提交的任务全部完成
+    void wait();
+
+    unsigned thread_count() const { return static_cast<unsigned>(threads_.size()); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    size_t next_queue_ = 0;
+
+    // 空闲线程在这里等待新任务，wait()在这里等待全部完成
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    std::atomic<size_t> queued_{0};     // 已提交未取走
+    std::atomic<size_t> pending_{0};    // 已提交未完成
+    bool stop_ = false;
+
+    bool take(unsigned index, std::function<void()>& task);
+    void worker(unsigned index);
+};
+
+} // namespace cnes
+
+#endif // CNES_WORK_POOL_H